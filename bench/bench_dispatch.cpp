@@ -0,0 +1,107 @@
+// Function dispatch cost: calling functions through Environment
+// and evaluating trees with eval()
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+
+using namespace std;
+using namespace stree;
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsed_ns(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+static Value plus(const Arguments& args, DataPtr) {
+    return args[0] + args[1];
+}
+
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// Build full tree of given depth from random non-terminals
+static Id full(Environment& env, unsigned depth, std::mt19937& prng) {
+    const SymbolPtrList& symbols = (depth > 1)
+        ? env.symbols().nonterminals()
+        : env.symbols().terminals();
+    std::uniform_int_distribution<std::size_t> dist(0, symbols.size() - 1);
+    Id id = env.make_id(symbols[dist(prng)]);
+    for (Arity n = 0; n < id.arity(); ++n)
+        id::nth_argument(env.node_manager(), id, n) = full(env, depth - 1, prng);
+    return id;
+}
+
+int main() {
+    // Functions: plain function pointer and lambda with state
+    // that does not fit into std::function small object buffer
+    struct State {
+        Value scale[8];
+    } state{{1, 1, 1, 1, 1, 1, 1, 1}};
+    Environment env;
+    env.add_function("+", 2, &::plus);
+    env.add_function("*", 2, [state](const Arguments& args, DataPtr) {
+        return args[0] * args[1] * state.scale[0];
+    });
+    env.add_select_function("pos", 2, 1, &::pos);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    const unsigned call_num = 10000000;
+    Arguments args{1, 1};
+    Value sum{};
+
+    // Function call, copying callable first
+    for (FunctionIndex fid = 0; fid < 2; ++fid) {
+        auto start = Clock::now();
+        for (unsigned i = 0; i < call_num; ++i) {
+            Function function = env.function(fid);
+            sum += function(args, nullptr);
+        }
+        cout << "copy + call, fid " << static_cast<unsigned>(fid) << ": "
+             << elapsed_ns(start) / call_num << " ns/call" << endl;
+    }
+
+    // Function call through environment
+    for (FunctionIndex fid = 0; fid < 2; ++fid) {
+        auto start = Clock::now();
+        for (unsigned i = 0; i < call_num; ++i)
+            sum += env.function(fid)(args, nullptr);
+        cout << "env call, fid " << static_cast<unsigned>(fid) << ": "
+             << elapsed_ns(start) / call_num << " ns/call" << endl;
+    }
+
+    // Tree evaluation
+    std::mt19937 prng(1);
+    Tree tree(&env, full(env, 8, prng));
+    NodeNum size = tree.describe().size;
+    const unsigned row_num = 20000;
+    std::uniform_real_distribution<Value> dist(-1, 1);
+    vector<Params> rows(row_num);
+    for (Params& params : rows)
+        params = {dist(prng), dist(prng)};
+    auto start = Clock::now();
+    for (const Params& params : rows)
+        sum += eval(tree, params);
+    cout << "eval, " << size << " nodes: "
+         << elapsed_ns(start) / (static_cast<double>(row_num) * size)
+         << " ns/node" << endl;
+
+    // Tree evaluation reusing context
+    EvalContext context;
+    start = Clock::now();
+    for (const Params& params : rows)
+        sum += eval(context, tree, params);
+    cout << "eval with context, " << size << " nodes: "
+         << elapsed_ns(start) / (static_cast<double>(row_num) * size)
+         << " ns/node" << endl;
+
+    // Print sum so that calls are not optimized out
+    cout << "checksum: " << sum << endl;
+    return 0;
+}
@@ -0,0 +1,120 @@
+// Population loading from text: Parser (one character at a time)
+// vs BulkParser vs ParallelParser
+// Usage: bench_parser [node_num] [thread_num]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+
+using namespace std;
+using namespace stree;
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// Build random tree, grow method, with some constants
+static Id grow(Environment& env, unsigned depth, std::mt19937& prng) {
+    std::uniform_int_distribution<unsigned> coin(0, 3);
+    if (depth == 1 && coin(prng) == 0)
+        return env.make_id(static_cast<Value>(coin(prng)) / 4);
+    const SymbolPtrList& symbols = (depth > 1 && coin(prng) > 0)
+        ? env.symbols().nonterminals()
+        : env.symbols().terminals();
+    std::uniform_int_distribution<std::size_t> dist(0, symbols.size() - 1);
+    Id id = env.make_id(symbols[dist(prng)]);
+    for (Arity n = 0; n < id.arity(); ++n)
+        id::nth_argument(env.node_manager(), id, n) = grow(env, depth - 1, prng);
+    return id;
+}
+
+int main(int argc, char** argv) {
+    std::size_t max_node_num = (argc > 1) ? std::atol(argv[1]) : 1000000;
+    unsigned thread_num = (argc > 2) ? std::atoi(argv[2]) : 0;
+
+    Environment env;
+    for (const char* name : {"+", "-", "*", "%", "min", "max"})
+        add_builtin(env, name);
+    env.add_select_function("pos", 2, 1, &::pos);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+    env.add_positional("z", 2);
+
+    // Population dump
+    std::string dump;
+    std::size_t node_num = 0;
+    std::size_t tree_num = 0;
+    {
+        std::mt19937 prng(1);
+        std::stringstream ss;
+        while (node_num < max_node_num) {
+            Tree tree(&env, grow(env, 10, prng));
+            node_num += tree.describe().size;
+            ss << tree << '\n';
+            ++tree_num;
+        }
+        dump = ss.str();
+    }
+    cout << tree_num << " trees, " << node_num << " nodes, "
+         << dump.size() / 1024 << " KiB" << endl;
+
+    // Each parser gets fresh shard, trees are destroyed after timing
+    std::unique_ptr<Environment> parser_env = env.make_shard();
+    vector<Tree> parser_trees;
+    auto start = Clock::now();
+    {
+        std::istringstream is(dump);
+        Parser p(parser_env.get());
+        while (true) {
+            p.parse(is);
+            if (!p.is_done())
+                break;
+            parser_trees.emplace_back(parser_env.get(), p.move_result());
+        }
+    }
+    double parser_time = elapsed_ms(start);
+    std::size_t parser_num = parser_trees.size();
+
+    std::unique_ptr<Environment> bulk_env = env.make_shard();
+    vector<Tree> bulk_trees;
+    start = Clock::now();
+    {
+        BulkParser bp(bulk_env.get());
+        bulk_trees = bp.make_trees(bp.parse(dump));
+    }
+    double bulk_time = elapsed_ms(start);
+    std::size_t bulk_num = bulk_trees.size();
+
+    // Parallel parser, shards are merged into fresh shard
+    Scheduler scheduler(thread_num);
+    std::unique_ptr<Environment> parallel_env = env.make_shard();
+    vector<Tree> parallel_trees;
+    start = Clock::now();
+    {
+        ParallelParser pp(scheduler);
+        parallel_trees = pp.parse(*parallel_env, dump);
+    }
+    double parallel_time = elapsed_ms(start);
+    std::size_t parallel_num = parallel_trees.size();
+
+    cout << "Parser:     " << parser_time << " ms (" << parser_num << " trees)"
+         << endl
+         << "BulkParser: " << bulk_time << " ms (" << bulk_num << " trees), "
+         << parser_time / bulk_time << "x" << endl
+         << "ParallelParser: " << parallel_time << " ms (" << parallel_num
+         << " trees, " << scheduler.worker_num() << " threads), "
+         << parser_time / parallel_time << "x" << endl;
+    return 0;
+}
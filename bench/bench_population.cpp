@@ -0,0 +1,91 @@
+// Population evaluation scaling: PopulationEval with 1 to 32 workers
+// Usage: bench_population [max_worker_num]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <stree/stree.hpp>
+
+using namespace std;
+using namespace stree;
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// Build random tree, grow method
+static Id grow(Environment& env, unsigned depth, std::mt19937& prng) {
+    std::uniform_int_distribution<unsigned> coin(0, 3);
+    const SymbolPtrList& symbols = (depth > 1 && coin(prng) > 0)
+        ? env.symbols().nonterminals()
+        : env.symbols().terminals();
+    std::uniform_int_distribution<std::size_t> dist(0, symbols.size() - 1);
+    Id id = env.make_id(symbols[dist(prng)]);
+    for (Arity n = 0; n < id.arity(); ++n)
+        id::nth_argument(env.node_manager(), id, n) = grow(env, depth - 1, prng);
+    return id;
+}
+
+int main(int argc, char** argv) {
+    unsigned max_worker_num = (argc > 1) ? std::atoi(argv[1]) : 32;
+
+    Environment env;
+    for (const char* name : {"+", "-", "*", "%", "min", "max"})
+        add_builtin(env, name);
+    env.add_select_function("pos", 2, 1, &::pos);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+    env.add_positional("z", 2);
+
+    // Population
+    const unsigned tree_num = 2000;
+    std::mt19937 prng(1);
+    vector<Tree> trees;
+    NodeNum node_num = 0;
+    for (unsigned n = 0; n < tree_num; ++n) {
+        trees.emplace_back(&env, grow(env, 8, prng));
+        node_num += trees.back().describe().size;
+    }
+
+    // Fitness cases
+    const std::size_t row_num = 4096;
+    ParamMatrix params(3, row_num);
+    std::uniform_real_distribution<Value> dist(-1, 1);
+    for (std::size_t row = 0; row < row_num; ++row)
+        for (std::size_t column = 0; column < 3; ++column)
+            params.at(row, column) = dist(prng);
+
+    cout << tree_num << " trees, " << node_num << " nodes, "
+         << row_num << " rows, "
+         << std::thread::hardware_concurrency() << " hardware threads" << endl;
+
+    vector<Value> results(tree_num * row_num);
+    double time_single = 0;
+    Value sum{};
+    for (unsigned worker_num = 1; worker_num <= max_worker_num; worker_num *= 2) {
+        Scheduler scheduler(worker_num);
+        PopulationEval population_eval(scheduler);
+        population_eval.eval(trees, params, results.data()); // warm up
+        auto start = Clock::now();
+        population_eval.eval(trees, params, results.data());
+        double time = elapsed_ms(start);
+        if (worker_num == 1)
+            time_single = time;
+        sum += results[worker_num];
+        cout << worker_num << " workers: " << time << " ms, "
+             << (time * 1e6 / (static_cast<double>(node_num) * row_num))
+             << " ns/node, speedup " << (time_single / time) << endl;
+    }
+
+    // Print sum so that evaluation is not optimized out
+    cout << "checksum: " << sum << endl;
+    return 0;
+}
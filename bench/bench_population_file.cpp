@@ -0,0 +1,114 @@
+// Population checkpoint: text (to_string + Parser) vs binary population
+// file (save_population + MappedPopulation)
+// Usage: bench_population_file [node_num]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+
+using namespace std;
+using namespace stree;
+
+using Clock = std::chrono::steady_clock;
+
+static const char* TextPath = "bench_population_file.txt";
+static const char* BinaryPath = "bench_population_file.bin";
+
+static double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// Build random tree, grow method
+static Id grow(Environment& env, unsigned depth, std::mt19937& prng) {
+    std::uniform_int_distribution<unsigned> coin(0, 3);
+    const SymbolPtrList& symbols = (depth > 1 && coin(prng) > 0)
+        ? env.symbols().nonterminals()
+        : env.symbols().terminals();
+    std::uniform_int_distribution<std::size_t> dist(0, symbols.size() - 1);
+    Id id = env.make_id(symbols[dist(prng)]);
+    for (Arity n = 0; n < id.arity(); ++n)
+        id::nth_argument(env.node_manager(), id, n) = grow(env, depth - 1, prng);
+    return id;
+}
+
+int main(int argc, char** argv) {
+    std::size_t max_node_num = (argc > 1) ? std::atol(argv[1]) : 1000000;
+
+    Environment env;
+    for (const char* name : {"+", "-", "*", "%", "min", "max"})
+        add_builtin(env, name);
+    env.add_select_function("pos", 2, 1, &::pos);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+    env.add_positional("z", 2);
+
+    // Population
+    std::mt19937 prng(1);
+    vector<Tree> trees;
+    std::size_t node_num = 0;
+    while (node_num < max_node_num) {
+        trees.emplace_back(&env, grow(env, 10, prng));
+        node_num += trees.back().describe().size;
+    }
+    cout << trees.size() << " trees, " << node_num << " nodes" << endl;
+
+    // Text
+    auto start = Clock::now();
+    {
+        std::ofstream ofs(TextPath);
+        for (const Tree& tree : trees)
+            ofs << tree << '\n';
+    }
+    double text_save = elapsed_ms(start);
+    start = Clock::now();
+    std::size_t text_num = 0;
+    {
+        std::ifstream ifs(TextPath);
+        Parser p(&env);
+        string line;
+        vector<Tree> loaded;
+        while (std::getline(ifs, line)) {
+            p.parse(line);
+            loaded.emplace_back(&env, p.move_result());
+        }
+        text_num = loaded.size();
+    }
+    double text_load = elapsed_ms(start);
+
+    // Binary
+    start = Clock::now();
+    save_population(BinaryPath, env, trees);
+    double binary_save = elapsed_ms(start);
+    start = Clock::now();
+    MappedPopulation population(env, BinaryPath);
+    double binary_load = elapsed_ms(start);
+    start = Clock::now();
+    Value sum{};
+    for (std::size_t n = 0; n < population.size(); ++n)
+        sum += population[n].eval(Params({1, 2, 3}));
+    double binary_eval = elapsed_ms(start);
+
+    cout << "text:   save " << text_save << " ms, load "
+         << text_load << " ms (" << text_num << " trees)" << endl
+         << "binary: save " << binary_save << " ms, map "
+         << binary_load << " ms (" << population.size() << " trees, "
+         << (population.is_zero_copy() ? "zero-copy" : "remapped") << ")"
+         << endl
+         << "eval from mapped file: " << binary_eval << " ms"
+         << " (sum " << sum << ")" << endl;
+
+    std::remove(TextPath);
+    std::remove(BinaryPath);
+    return 0;
+}
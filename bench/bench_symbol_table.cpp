@@ -0,0 +1,116 @@
+// Symbol lookup cost: SymbolTable lookups, Parser and Exec throughput
+// Usage: bench_symbol_table [node_num]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+
+using namespace std;
+using namespace stree;
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsed_ns(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// Build random tree, grow method
+static Id grow(Environment& env, unsigned depth, std::mt19937& prng) {
+    std::uniform_int_distribution<unsigned> coin(0, 3);
+    const SymbolPtrList& symbols = (depth > 1 && coin(prng) > 0)
+        ? env.symbols().nonterminals()
+        : env.symbols().terminals();
+    std::uniform_int_distribution<std::size_t> dist(0, symbols.size() - 1);
+    Id id = env.make_id(symbols[dist(prng)]);
+    for (Arity n = 0; n < id.arity(); ++n)
+        id::nth_argument(env.node_manager(), id, n) = grow(env, depth - 1, prng);
+    return id;
+}
+
+int main(int argc, char** argv) {
+    std::size_t max_node_num = (argc > 1) ? std::atol(argv[1]) : 1000000;
+
+    Environment env;
+    for (const std::string& name : builtin_names())
+        add_builtin(env, name);
+    env.add_select_function("pos", 2, 1, &::pos);
+    for (Position n = 0; n < 16; ++n)
+        env.add_positional("x" + std::to_string(n), n);
+    Params params(16, 0.5);
+
+    std::mt19937 prng(1);
+    vector<Tree> trees;
+    std::size_t node_num = 0;
+    while (node_num < max_node_num) {
+        trees.emplace_back(&env, grow(env, 8, prng));
+        node_num += trees.back().describe().size;
+    }
+    std::stringstream ss;
+    for (const Tree& tree : trees)
+        ss << tree << '\n';
+    std::string dump = ss.str();
+    cout << env.symbols().size() << " symbols, " << trees.size()
+         << " trees, " << node_num << " nodes" << endl;
+
+    // Lookup by name
+    const unsigned lookup_num = 10000000;
+    std::size_t sum = 0;
+    auto start = Clock::now();
+    for (unsigned i = 0; i < lookup_num; ++i) {
+        const SymbolPtr& symbol = env.symbols()[i % env.symbols().size()];
+        sum += env.symbols().by_name(symbol->name())->arity();
+    }
+    cout << "by_name: " << elapsed_ns(start) / lookup_num << " ns" << endl;
+
+    // Lookup by ID
+    vector<Id> ids;
+    for (std::size_t n = 0; n < env.symbols().size(); ++n)
+        ids.push_back(env.make_id(env.symbols()[n]));
+    start = Clock::now();
+    for (unsigned i = 0; i < lookup_num; ++i)
+        sum += env.symbols().by_id(ids[i % ids.size()])->arity();
+    cout << "by_id: " << elapsed_ns(start) / lookup_num << " ns" << endl;
+    for (Id& id : ids)
+        id::destroy(env.node_manager(), id);
+
+    // Parser
+    start = Clock::now();
+    {
+        std::istringstream is(dump);
+        Parser p(&env);
+        while (true) {
+            p.parse(is);
+            if (!p.is_done())
+                break;
+            Tree tree(&env, p.move_result());
+            sum += tree.root().arity();
+        }
+    }
+    double parse_ns = elapsed_ns(start);
+    cout << "Parser: " << parse_ns / node_num << " ns/node, "
+         << dump.size() * 1000 / parse_ns << " MB/s" << endl;
+
+    // Exec
+    Value value_sum{};
+    start = Clock::now();
+    for (const Tree& tree : trees) {
+        Exec exec(tree, Exec::FlagStopOnFinished);
+        exec.init(&params);
+        exec.run();
+        value_sum += exec.result();
+    }
+    cout << "Exec: " << elapsed_ns(start) / node_num << " ns/node" << endl;
+
+    // Print sum so that calls are not optimized out
+    cout << "checksum: " << sum << " " << value_sum << endl;
+    return 0;
+}
@@ -0,0 +1,290 @@
+#include <stree/batch_eval.hpp>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace stree {
+
+// ParamMatrix
+
+ParamMatrix::ParamMatrix(const std::vector<Params>& rows)
+    : column_num_(0),
+      row_num_(rows.size())
+{
+    for (const Params& params : rows)
+        column_num_ = std::max(column_num_, params.size());
+    data_.resize(column_num_ * row_num_);
+    for (std::size_t n = 0; n < rows.size(); ++n)
+        set_row(n, rows[n]);
+}
+
+const Value* ParamMatrix::column(std::size_t n) const {
+    assert(n < column_num_ && "Invalid column number");
+    return data_.data() + n * row_num_;
+}
+
+Value* ParamMatrix::column(std::size_t n) {
+    assert(n < column_num_ && "Invalid column number");
+    return data_.data() + n * row_num_;
+}
+
+const Value& ParamMatrix::at(std::size_t row, std::size_t column) const {
+    if (row >= row_num_ || column >= column_num_)
+        throw std::out_of_range("Invalid parameter matrix index");
+    return data_[column * row_num_ + row];
+}
+
+Value& ParamMatrix::at(std::size_t row, std::size_t column) {
+    return const_cast<Value&>(
+        const_cast<const ParamMatrix*>(this)->at(row, column));
+}
+
+Params ParamMatrix::row(std::size_t row) const {
+    Params params(column_num_);
+    for (std::size_t n = 0; n < column_num_; ++n)
+        params[n] = at(row, n);
+    return params;
+}
+
+void ParamMatrix::set_row(std::size_t row, const Params& params) {
+    if (params.size() > column_num_)
+        throw std::out_of_range("Too many parameters");
+    for (std::size_t n = 0; n < column_num_; ++n)
+        at(row, n) = (n < params.size()) ? params[n] : Value{};
+}
+
+
+// BatchEval
+
+BatchEval::BatchEval(std::size_t block_size)
+    : block_size_(block_size),
+      env_(nullptr),
+      params_(nullptr),
+      data_(nullptr),
+      value_buffers_used_(0),
+      index_buffers_used_(0)
+{
+    if (block_size_ == 0)
+        throw std::invalid_argument("Block size cannot be zero");
+}
+
+void BatchEval::eval(
+    const Environment& env,
+    const Id& root,
+    const ParamMatrix& params,
+    Value* out,
+    DataPtr data)
+{
+    eval(env, root, params, 0, params.row_num(), out, data);
+}
+
+void BatchEval::eval(
+    const Environment& env,
+    const Id& root,
+    const ParamMatrix& params,
+    std::size_t first_row,
+    std::size_t row_num,
+    Value* out,
+    DataPtr data)
+{
+    assert(
+        id::is_valid_subtree(env.node_manager(), root)
+        && "Cannot eval invalid subtree");
+    assert(first_row + row_num <= params.row_num() && "Invalid row range");
+    env_ = &env;
+    params_ = &params;
+    data_ = data;
+    // buffers may be left in use by exception thrown from function
+    value_buffers_used_ = 0;
+    index_buffers_used_ = 0;
+    argument_columns_.clear();
+    for (std::size_t n = 0; n < row_num; n += block_size_) {
+        Rows rows(first_row + n, std::min(block_size_, row_num - n));
+        Value* block_out = out + n;
+        const Value* result = eval_node(root, rows, block_out);
+        if (result != block_out)
+            std::copy(result, result + rows.size, block_out);
+    }
+    assert(value_buffers_used_ == 0 && index_buffers_used_ == 0);
+}
+
+const Value* BatchEval::eval_node(const Id& id, const Rows& rows, Value* out) {
+    switch (id.type()) {
+        case TypeConst: {
+            Value value = id::value(env_->node_manager(), id);
+            std::fill(out, out + rows.size, value);
+            return out;
+        }
+        case TypePositional:
+            return eval_positional(id, rows, out);
+        case TypeFunction:
+            return eval_function(id, rows, out);
+        case TypeSelect:
+            return eval_select(id, rows, out);
+    }
+    assert(false);
+}
+
+const Value* BatchEval::eval_positional(
+    const Id& id,
+    const Rows& rows,
+    Value* out)
+{
+    Position position = id::position(env_->node_manager(), id);
+    assert(
+        position < params_->column_num()
+        && "Invalid positional argument index");
+    const Value* column = params_->column(position);
+    if (!rows.list)
+        return column + rows.first; // no need to copy
+    for (std::size_t n = 0; n < rows.size; ++n)
+        out[n] = column[rows.list[n]];
+    return out;
+}
+
+const Value* BatchEval::eval_function(
+    const Id& id,
+    const Rows& rows,
+    Value* out)
+{
+    // Evaluate arguments
+    Arity argument_num = id.arity();
+    std::size_t base = argument_columns_.size();
+    for (Arity n = 0; n < argument_num; ++n) {
+        const Id& argument = id::nth_argument(env_->node_manager(), id, n);
+        argument_columns_.push_back(
+            eval_node(argument, rows, acquire_values()));
+    }
+
+    FunctionIndex fid = id::fid(env_->node_manager(), id);
+    const Value* const* columns = argument_columns_.data() + base;
+    if (env_->has_batch_function(fid)) {
+        // Apply kernel to whole block
+        env_->batch_function(fid)(columns, out, rows.size, data_);
+    } else {
+        // Apply function row by row
+        const Function& function = env_->function(fid);
+        arguments_.resize(argument_num);
+        for (std::size_t i = 0; i < rows.size; ++i) {
+            for (Arity n = 0; n < argument_num; ++n)
+                arguments_[n] = columns[n][i];
+            out[i] = function(arguments_, data_);
+        }
+    }
+
+    argument_columns_.resize(base);
+    release_values(argument_num);
+    return out;
+}
+
+const Value* BatchEval::eval_select(
+    const Id& id,
+    const Rows& rows,
+    Value* out)
+{
+    // Evaluate select function arguments
+    Arity argument_num = get_argument_num(*env_, id);
+    std::size_t base = argument_columns_.size();
+    for (Arity n = 0; n < argument_num; ++n) {
+        const Id& argument = id::nth_argument(env_->node_manager(), id, n);
+        argument_columns_.push_back(
+            eval_node(argument, rows, acquire_values()));
+    }
+
+    // Select branches,
+    // copy result for branches evaluated as select function arguments
+    const SelectFunction& select_function =
+        env_->select_function(id::sfid(env_->node_manager(), id));
+    const Value* const* columns = argument_columns_.data() + base;
+    RowIndex* branches = acquire_indices();
+    bool has_branches = false;
+    arguments_.resize(argument_num);
+    for (std::size_t i = 0; i < rows.size; ++i) {
+        for (Arity n = 0; n < argument_num; ++n)
+            arguments_[n] = columns[n][i];
+        unsigned branch = select_function(arguments_, data_);
+        assert(branch < id.arity() && "Invalid branch selected");
+        branches[i] = branch;
+        if (branch < argument_num) {
+            out[i] = columns[branch][i];
+        } else {
+            has_branches = true;
+        }
+    }
+    argument_columns_.resize(base);
+    release_values(argument_num);
+
+    // Evaluate other branches for rows they were selected for
+    if (has_branches) {
+        RowIndex* positions = acquire_indices();
+        RowIndex* branch_rows = acquire_indices();
+        Value* values = acquire_values();
+        for (Arity branch = argument_num; branch < id.arity(); ++branch) {
+            std::size_t size = 0;
+            for (std::size_t i = 0; i < rows.size; ++i) {
+                if (branches[i] == branch) {
+                    positions[size] = i;
+                    branch_rows[size] = rows[i];
+                    ++size;
+                }
+            }
+            if (size == 0)
+                continue;
+            const Value* result = eval_node(
+                id::nth_argument(env_->node_manager(), id, branch),
+                Rows(branch_rows, size),
+                values);
+            for (std::size_t i = 0; i < size; ++i)
+                out[positions[i]] = result[i];
+        }
+        release_values();
+        release_indices(2);
+    }
+    release_indices();
+    return out;
+}
+
+Value* BatchEval::acquire_values() {
+    if (value_buffers_used_ == value_buffers_.size())
+        value_buffers_.emplace_back(block_size_);
+    return value_buffers_[value_buffers_used_++].data();
+}
+
+void BatchEval::release_values(unsigned n) {
+    assert(value_buffers_used_ >= n);
+    value_buffers_used_ -= n;
+}
+
+BatchEval::RowIndex* BatchEval::acquire_indices() {
+    if (index_buffers_used_ == index_buffers_.size())
+        index_buffers_.emplace_back(block_size_);
+    return index_buffers_[index_buffers_used_++].data();
+}
+
+void BatchEval::release_indices(unsigned n) {
+    assert(index_buffers_used_ >= n);
+    index_buffers_used_ -= n;
+}
+
+
+void eval_batch(
+    const Environment& env,
+    const Id& root,
+    const ParamMatrix& params,
+    Value* out,
+    DataPtr data)
+{
+    BatchEval batch_eval;
+    batch_eval.eval(env, root, params, out, data);
+}
+
+void eval_batch(
+    const Tree& tree,
+    const ParamMatrix& params,
+    Value* out,
+    DataPtr data)
+{
+    eval_batch(*tree.env(), tree.root(), params, out, data);
+}
+
+} // namespace stree
@@ -0,0 +1,329 @@
+#include <stree/batch_exec.hpp>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace stree {
+
+BatchExec::BatchExec(const Environment& env, const Id& root, Flag flags)
+    : env_(env),
+      root_(root),
+      flags_(flags),
+      cost_limit_(-1),
+      node_eval_num_(0),
+      group_eval_num_(0) {}
+
+void BatchExec::set_agent_function(FunctionIndex fid, AgentFunction function) {
+    if (!env_.symbols().find_by_fid(fid))
+        throw std::invalid_argument("Function not found");
+    if (agent_functions_.size() <= fid)
+        agent_functions_.resize(fid + 1);
+    agent_functions_[fid] = std::move(function);
+}
+
+void BatchExec::set_agent_function(
+    const std::string& name,
+    AgentFunction function)
+{
+    const SymbolPtr& symbol = env_.symbols().by_name(name);
+    if (symbol->type() != TypeFunction)
+        throw std::invalid_argument(
+            std::string("Symbol `") + name + "' is not a function");
+    set_agent_function(symbol->fid(), std::move(function));
+}
+
+std::size_t BatchExec::add_agent(Params* params, DataPtr data) {
+    agents_.emplace_back();
+    Agent& agent = agents_.back();
+    agent.params = params;
+    agent.data = data;
+    agent.cost_used = 0;
+    agent.status = Exec::StatusOk;
+    agent.result = Value{};
+    agent_restart(agent);
+    return agents_.size() - 1;
+}
+
+BatchExec::Status BatchExec::step() {
+    return advance(true, true);
+}
+
+BatchExec::Status BatchExec::run() {
+    if (has_flag(Exec::FlagRunLoop)) {
+        while (true) {
+            if (step() != Exec::StatusOk)
+                return Exec::StatusCostLimitExceeded;
+        }
+    }
+    // Agents stopped by cost limit are retried once
+    Status status = advance(false, true);
+    while (!is_finished()) {
+        bool is_running = false;
+        for (const Agent& agent : agents_) {
+            is_running |= !agent.is_finished
+                && agent.status == Exec::StatusOk;
+        }
+        if (!is_running)
+            break;
+        if (advance(false, false) != Exec::StatusOk)
+            status = Exec::StatusCostLimitExceeded;
+    }
+    return status;
+}
+
+void BatchExec::restart() {
+    for (Agent& agent : agents_)
+        agent_restart(agent);
+}
+
+bool BatchExec::is_finished() const {
+    for (const Agent& agent : agents_)
+        if (!agent.is_finished)
+            return false;
+    return true;
+}
+
+BatchExec::Status BatchExec::advance(
+    bool restart_finished,
+    bool retry_exceeded)
+{
+    active_.clear();
+    for (std::size_t n = 0; n < agents_.size(); ++n) {
+        Agent& agent = agents_[n];
+        if (agent.is_finished && !restart_finished)
+            continue;
+        if (agent.status != Exec::StatusOk && !retry_exceeded)
+            continue;
+        agent.is_stopped = false;
+        agent.status = Exec::StatusOk;
+        active_.push_back(n);
+    }
+    Status status = Exec::StatusOk;
+
+    while (!active_.empty()) {
+        // Find deepest ready agents
+        std::size_t max_depth = 0;
+        for (std::size_t n : active_) {
+            descend(agents_[n]);
+            max_depth = std::max(max_depth, agents_[n].stack.size());
+        }
+        ready_.clear();
+        for (std::size_t n : active_)
+            if (agents_[n].stack.size() == max_depth)
+                ready_.push_back(n);
+
+        // Group by node
+        std::sort(
+            ready_.begin(), ready_.end(),
+            [this](std::size_t a, std::size_t b) {
+                return agents_[a].stack.back().id.hash()
+                    < agents_[b].stack.back().id.hash();
+            });
+        std::size_t first = 0;
+        while (first < ready_.size()) {
+            const Id& id = agents_[ready_[first]].stack.back().id;
+            std::size_t last = first + 1;
+            while (last < ready_.size()
+                   && agents_[ready_[last]].stack.back().id == id)
+                ++last;
+            eval_group(ready_.data() + first, last - first);
+            first = last;
+        }
+
+        // Remove stopped agents
+        active_.erase(
+            std::remove_if(
+                active_.begin(), active_.end(),
+                [this, &status](std::size_t n) {
+                    if (agents_[n].status != Exec::StatusOk)
+                        status = Exec::StatusCostLimitExceeded;
+                    return agents_[n].is_stopped;
+                }),
+            active_.end());
+    }
+    return status;
+}
+
+void BatchExec::descend(Agent& agent) {
+    if (agent.is_finished)
+        agent_restart(agent);
+    while (true) {
+        const Frame& top = agent.stack.back();
+        std::size_t n = agent.values.size() - top.base;
+        if (n == top.argument_num)
+            break;
+        Id id = id::nth_argument(env_.node_manager(), top.id, n);
+        agent_push(agent, id);
+    }
+}
+
+void BatchExec::eval_group(std::size_t* group, std::size_t size) {
+    const NodeManager& nm = env_.node_manager();
+    Id id = agents_[group[0]].stack.back().id;
+
+    // Check cost
+    Cost cost = 0;
+    if (id.type() != TypeConst)
+        cost = env_.symbols().by_id(id)->cost();
+    if (has_cost_limit()) {
+        auto is_within_limit = [this, cost](std::size_t n) {
+            return agents_[n].cost_used + cost <= cost_limit_;
+        };
+        if (!has_flag(Exec::FlagNoThrow)) {
+            if (!std::all_of(group, group + size, is_within_limit))
+                throw ExecCostLimitExceeded();
+        } else {
+            // Stop agents exceeding limit, top frame is not evaluated
+            std::size_t* end = std::partition(
+                group, group + size, is_within_limit);
+            for (std::size_t* it = end; it != group + size; ++it) {
+                agents_[*it].is_stopped = true;
+                agents_[*it].status = Exec::StatusCostLimitExceeded;
+            }
+            size = end - group;
+            if (size == 0)
+                return;
+        }
+    }
+
+    switch (id.type()) {
+        case TypeConst: {
+            Value value = id::value(nm, id);
+            for (std::size_t n = 0; n < size; ++n)
+                agent_return(agents_[group[n]], value);
+            break;
+        }
+        case TypePositional: {
+            Position position = id::position(nm, id);
+            for (std::size_t n = 0; n < size; ++n) {
+                Agent& agent = agents_[group[n]];
+                assert(
+                    position < agent.params->size()
+                    && "Invalid positional argument index");
+                agent_return(agent, (*agent.params)[position]);
+            }
+            break;
+        }
+        case TypeFunction:
+            eval_function(group, size);
+            break;
+        case TypeSelect: {
+            SelectFunctionIndex sfid = id::sfid(nm, id);
+            for (std::size_t n = 0; n < size; ++n) {
+                Agent& agent = agents_[group[n]];
+                const Frame& top = agent.stack.back();
+                ArgumentSpan arguments(
+                    agent.values.data() + top.base,
+                    agent.values.size() - top.base);
+                unsigned branch = context_.call_select_function(
+                    env_, sfid, arguments, agent.data);
+                assert(branch < id.arity() && "Invalid branch selected");
+                if (branch < arguments.size()) {
+                    // branch already evaluated as select function argument
+                    agent_return(agent, arguments[branch]);
+                } else {
+                    // push selected branch
+                    Id branch_id = id::nth_argument(nm, id, branch);
+                    agent_pop(agent);
+                    agent_push(agent, branch_id);
+                }
+            }
+            break;
+        }
+    }
+
+    // Update cost counters, check if need to stop
+    for (std::size_t n = 0; n < size; ++n) {
+        Agent& agent = agents_[group[n]];
+        agent.cost_used += cost;
+        agent.is_stopped = should_stop(agent, cost, id.type());
+    }
+    node_eval_num_ += size;
+    ++group_eval_num_;
+}
+
+void BatchExec::eval_function(const std::size_t* group, std::size_t size) {
+    const Id id = agents_[group[0]].stack.back().id;
+    FunctionIndex fid = id::fid(env_.node_manager(), id);
+
+    if (fid < agent_functions_.size() && agent_functions_[fid]) {
+        // Call kernel once for all agents
+        Arity arity = id.arity();
+        columns_.resize(arity * size);
+        column_ptrs_.resize(arity);
+        data_.resize(size);
+        out_.resize(size);
+        for (Arity k = 0; k < arity; ++k)
+            column_ptrs_[k] = columns_.data() + k * size;
+        for (std::size_t n = 0; n < size; ++n) {
+            const Agent& agent = agents_[group[n]];
+            const Value* arguments = agent.values.data()
+                + agent.stack.back().base;
+            for (Arity k = 0; k < arity; ++k)
+                columns_[k * size + n] = arguments[k];
+            data_[n] = agent.data;
+        }
+        agent_functions_[fid](
+            column_ptrs_.data(), out_.data(), size, data_.data());
+        for (std::size_t n = 0; n < size; ++n)
+            agent_return(agents_[group[n]], out_[n]);
+        return;
+    }
+
+    for (std::size_t n = 0; n < size; ++n) {
+        Agent& agent = agents_[group[n]];
+        const Frame& top = agent.stack.back();
+        Value value = context_.call_function(
+            env_, fid,
+            ArgumentSpan(
+                agent.values.data() + top.base,
+                agent.values.size() - top.base),
+            agent.data);
+        agent_return(agent, value);
+    }
+}
+
+bool BatchExec::should_stop(const Agent& agent, Cost cost, Type type) const {
+    bool stop = false;
+    stop |= (agent.is_finished && has_flag(Exec::FlagStopOnFinished));
+    stop |= (cost > 0 && has_flag(Exec::FlagStopIfCostNotZero));
+    stop |= (type == TypeFunction && has_flag(Exec::FlagStopOnFunctions));
+    stop |= (type == TypeSelect && has_flag(Exec::FlagStopOnSelects));
+    return stop;
+}
+
+void BatchExec::agent_restart(Agent& agent) {
+    agent.stack.clear();
+    agent.values.clear();
+    agent.is_finished = false;
+    agent.is_stopped = false;
+    agent_push(agent, root_);
+}
+
+void BatchExec::agent_push(Agent& agent, const Id& id) {
+    Arity argument_num = get_argument_num(env_, id);
+    agent.stack.emplace_back(id, argument_num, agent.values.size());
+}
+
+void BatchExec::agent_return(Agent& agent, Value value) {
+    agent_pop(agent);
+    if (agent.stack.empty()) {
+        // finished
+        agent.is_finished = true;
+        agent.result = value;
+    } else {
+        // set next argument to result
+        assert(
+            agent.values.size() - agent.stack.back().base
+                < agent.stack.back().argument_num
+            && "Too many arguments");
+        agent.values.push_back(value);
+    }
+}
+
+void BatchExec::agent_pop(Agent& agent) {
+    agent.values.resize(agent.stack.back().base);
+    agent.stack.pop_back();
+}
+
+} // namespace stree
@@ -0,0 +1,107 @@
+#include <stree/builtins.hpp>
+#include <cassert>
+#include <stdexcept>
+
+namespace stree {
+
+namespace {
+
+// Scalar and batch versions of binary operator,
+// batch loop is simple enough to be vectorized by compiler
+#define STREE_TMP_BINARY(_name, _expr)                                  \
+    Value _name(const Arguments& args, DataPtr) {                       \
+        assert(args.size() == 2);                                       \
+        const Value a = args[0];                                        \
+        const Value b = args[1];                                        \
+        return (_expr);                                                 \
+    }                                                                   \
+    void _name ## _batch(                                               \
+        const Value* const* args, Value* out, std::size_t n, DataPtr)   \
+    {                                                                   \
+        const Value* as = args[0];                                      \
+        const Value* bs = args[1];                                      \
+        for (std::size_t i = 0; i < n; ++i) {                           \
+            const Value a = as[i];                                      \
+            const Value b = bs[i];                                      \
+            out[i] = (_expr);                                           \
+        }                                                               \
+    }
+
+STREE_TMP_BINARY(add, a + b)
+STREE_TMP_BINARY(sub, a - b)
+STREE_TMP_BINARY(mul, a * b)
+STREE_TMP_BINARY(div, (b != Value{}) ? a / b : static_cast<Value>(1))
+STREE_TMP_BINARY(min, (b < a) ? b : a)
+STREE_TMP_BINARY(max, (a < b) ? b : a)
+STREE_TMP_BINARY(lt, static_cast<Value>(a < b))
+STREE_TMP_BINARY(le, static_cast<Value>(a <= b))
+STREE_TMP_BINARY(gt, static_cast<Value>(a > b))
+STREE_TMP_BINARY(ge, static_cast<Value>(a >= b))
+STREE_TMP_BINARY(eq, static_cast<Value>(a == b))
+STREE_TMP_BINARY(ne, static_cast<Value>(a != b))
+
+#undef STREE_TMP_BINARY
+
+#define STREE_TMP_BUILTIN(_name, _fun) \
+    {_name, 2, &_fun, &_fun ## _batch}
+
+const std::vector<Builtin>& builtins() {
+    static const std::vector<Builtin> builtins{
+        STREE_TMP_BUILTIN("+", add),
+        STREE_TMP_BUILTIN("-", sub),
+        STREE_TMP_BUILTIN("*", mul),
+        STREE_TMP_BUILTIN("%", div),
+        STREE_TMP_BUILTIN("min", min),
+        STREE_TMP_BUILTIN("max", max),
+        STREE_TMP_BUILTIN("<", lt),
+        STREE_TMP_BUILTIN("<=", le),
+        STREE_TMP_BUILTIN(">", gt),
+        STREE_TMP_BUILTIN(">=", ge),
+        STREE_TMP_BUILTIN("==", eq),
+        STREE_TMP_BUILTIN("!=", ne)
+    };
+    return builtins;
+}
+
+#undef STREE_TMP_BUILTIN
+
+} // namespace
+
+
+const Builtin* find_builtin(const std::string& name) {
+    for (const Builtin& builtin : builtins())
+        if (name == builtin.name)
+            return &builtin;
+    return nullptr;
+}
+
+std::vector<std::string> builtin_names() {
+    std::vector<std::string> names;
+    for (const Builtin& builtin : builtins())
+        names.emplace_back(builtin.name);
+    return names;
+}
+
+void add_builtin(Environment& env, const std::string& builtin, Cost cost) {
+    add_builtin(env, builtin, builtin, cost);
+}
+
+void add_builtin(
+    Environment& env,
+    const std::string& name,
+    const std::string& builtin,
+    Cost cost)
+{
+    const Builtin* item = find_builtin(builtin);
+    if (!item)
+        throw std::invalid_argument(
+            std::string("Built-in function `") + builtin + "' not found");
+    env.add_function(
+        name,
+        item->arity,
+        item->function,
+        item->batch_function,
+        cost);
+}
+
+} // namespace stree
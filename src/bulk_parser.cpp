@@ -0,0 +1,441 @@
+#include <stree/bulk_parser.hpp>
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <system_error>
+#include <stree/mapped_file.hpp>
+
+namespace {
+
+enum CharClass : std::uint8_t {
+    CharInvalid,
+    CharSpace,
+    CharParenLeft,
+    CharParenRight,
+    CharDigit,
+    CharDot,
+    CharIdent
+};
+
+// Same character sets as in Parser
+class CharTable {
+public:
+    CharTable() {
+        for (CharClass& c : table_)
+            c = CharInvalid;
+        set(" \t\r\n", CharSpace);
+        set("(", CharParenLeft);
+        set(")", CharParenRight);
+        set("0123456789", CharDigit);
+        set(".", CharDot);
+        set("abcdefghijklmnopqrstuvwxyz", CharIdent);
+        set("-+*/%", CharIdent);
+        set("=<>!&|^", CharIdent);
+        set("_:?@#$", CharIdent);
+    }
+
+    CharClass operator[](char c) const {
+        return table_[static_cast<unsigned char>(c)];
+    }
+
+private:
+    void set(const char* chars, CharClass c) {
+        for (; *chars != '\0'; ++chars)
+            table_[static_cast<unsigned char>(*chars)] = c;
+    }
+
+    CharClass table_[256];
+};
+
+const CharTable Chars;
+
+enum TokenType {
+    TokenEnd,
+    TokenParenLeft,
+    TokenParenRight,
+    TokenNumber,
+    TokenSymbol
+};
+
+struct Token {
+    TokenType type;
+    std::size_t pos;
+    std::string_view text;
+};
+
+// Error and its position, Parser::ErrorOk if no error
+struct TokenError {
+    stree::Parser::Error error;
+    std::size_t pos;
+};
+
+// Read next token starting from `pos', moves `pos' to token end
+TokenError next_token(
+    const char* data,
+    std::size_t size,
+    std::size_t& pos,
+    Token& token)
+{
+    using stree::Parser;
+
+    while (pos < size && Chars[data[pos]] == CharSpace)
+        ++pos;
+    token.pos = pos;
+    if (pos == size) {
+        token.type = TokenEnd;
+        return {Parser::ErrorOk, pos};
+    }
+
+    CharClass first = Chars[data[pos]];
+    switch (first) {
+        case CharParenLeft:
+            token.type = TokenParenLeft;
+            ++pos;
+            return {Parser::ErrorOk, pos};
+        case CharParenRight:
+            token.type = TokenParenRight;
+            ++pos;
+            return {Parser::ErrorOk, pos};
+        case CharDigit:
+        case CharIdent:
+            break;
+        default:
+            return {Parser::ErrorInvalidChar, pos};
+    }
+
+    // Number or symbol
+    auto is = [data, size](std::size_t pos, CharClass c) {
+        return pos < size && Chars[data[pos]] == c;
+    };
+    if (first == CharDigit) {
+        token.type = TokenNumber;
+        for (++pos; is(pos, CharDigit); ++pos) {}
+        if (is(pos, CharDot))
+            for (++pos; is(pos, CharDigit); ++pos) {}
+    } else {
+        token.type = TokenSymbol;
+        for (++pos; is(pos, CharIdent) || is(pos, CharDigit); ++pos) {}
+    }
+    if (pos < size) {
+        switch (Chars[data[pos]]) {
+            case CharSpace:
+            case CharParenRight:
+                break;
+            case CharIdent:
+                return {Parser::ErrorUnexpectedNonNumber, pos};
+            case CharDot:
+                return {
+                    (token.type == TokenNumber)
+                        ? Parser::ErrorNumberUnexpectedDot
+                        : Parser::ErrorInvalidChar,
+                    pos};
+            case CharParenLeft:
+                return {Parser::ErrorUnexpectedLeftParen, pos};
+            default:
+                return {Parser::ErrorInvalidChar, pos};
+        }
+    }
+    token.text = std::string_view(data + token.pos, pos - token.pos);
+    return {Parser::ErrorOk, pos};
+}
+
+// Exact powers of 10 for fast path
+constexpr double Pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14};
+
+TokenError to_number(const Token& token, stree::Value& value) {
+    using stree::Parser;
+
+    // Fast path: mantissa and power of 10 are exact doubles,
+    // so division is correctly rounded, same as from_chars
+    if (token.text.size() <= 15) {
+        std::uint64_t mantissa = 0;
+        std::size_t frac_num = 0;
+        bool dot = false;
+        for (char c : token.text) {
+            if (c == '.') {
+                dot = true;
+            } else {
+                mantissa = mantissa * 10 + (c - '0');
+                frac_num += dot;
+            }
+        }
+        value = static_cast<stree::Value>(
+            static_cast<double>(mantissa) / Pow10[frac_num]);
+        return {Parser::ErrorOk, token.pos};
+    }
+
+    double number = 0;
+    const char* end = token.text.data() + token.text.size();
+    auto result = std::from_chars(token.text.data(), end, number);
+    if (result.ec == std::errc::result_out_of_range)
+        return {Parser::ErrorNumberOutOfRange, token.pos};
+    if (result.ec != std::errc() || result.ptr != end)
+        return {Parser::ErrorNumberInvalid, token.pos};
+    value = static_cast<stree::Value>(number);
+    return {Parser::ErrorOk, token.pos};
+}
+
+std::size_t count_index(stree::Type type, stree::Arity arity) {
+    return (static_cast<std::size_t>(type) << 8) | arity;
+}
+
+} // anonymous namespace
+
+
+namespace stree {
+
+BulkParser::BulkParser(Environment* env)
+    : env_(env),
+      number_entry_{},
+      counts_(count_index(TypeSelect, 255) + 1)
+{
+    assert(env_);
+    number_entry_.type = TypeConst;
+}
+
+std::vector<Id> BulkParser::parse(const char* data, std::size_t size) {
+    update_symbols();
+    std::fill(counts_.begin(), counts_.end(), 0);
+    std::size_t tree_num = check(data, size);
+
+    // Reserve pool capacity
+    NodeManager& nm = env_->node_manager();
+    for (TypeId type = TypeConst; type <= TypeSelect; ++type) {
+        for (unsigned arity = 0; arity <= 255; ++arity) {
+            std::size_t num = counts_[count_index(type_id_to_type(type), arity)];
+            if (num > 0)
+                nm.reserve(type_id_to_type(type), arity, num);
+        }
+    }
+
+    std::vector<Id> roots;
+    roots.reserve(tree_num);
+    make(roots);
+    assert(roots.size() == tree_num);
+    return roots;
+}
+
+std::vector<Id> BulkParser::parse_file(const std::string& path) {
+    MappedFile file(path);
+    return parse(file.data(), file.size());
+}
+
+std::vector<Tree> BulkParser::make_trees(std::vector<Id>&& roots) {
+    std::vector<Tree> trees;
+    trees.reserve(roots.size());
+    for (Id& root : roots)
+        trees.emplace_back(env_, id::move(root));
+    roots.clear();
+    return trees;
+}
+
+std::size_t BulkParser::check(const char* data, std::size_t size) {
+    std::size_t tree_num = 0;
+    bool expect_callable = false; // after left paren
+    std::size_t pos = 0;
+    Token token;
+    stack_.clear();
+    tokens_.clear();
+    values_.clear();
+    while (true) {
+        TokenError token_error = next_token(data, size, pos, token);
+        if (token_error.error != Parser::ErrorOk)
+            error(token_error.error, data, token_error.pos);
+
+        if (token.type == TokenEnd) {
+            if (expect_callable || !stack_.empty())
+                error(Parser::ErrorUnexpectedEnd, data, token.pos);
+            break;
+        }
+
+        if (expect_callable) {
+            switch (token.type) {
+                case TokenParenLeft:
+                    error(Parser::ErrorUnexpectedLeftParen, data, token.pos);
+                case TokenParenRight:
+                    error(Parser::ErrorUnexpectedRightParen, data, token.pos);
+                case TokenNumber:
+                    error(Parser::ErrorUnexpectedNumber, data, token.pos);
+                default:
+                    break;
+            }
+            const Entry* entry = find_symbol(token.text);
+            if (!entry)
+                error(Parser::ErrorSymbolNotFound, data, token.pos);
+            if (!entry->is_callable)
+                error(Parser::ErrorSymbolUnexpectedVariable, data, token.pos);
+            if (!stack_.empty()) {
+                Frame& top = stack_.back();
+                if (top.child_num == top.arity)
+                    error(Parser::ErrorTooManyArguments, data, token.pos);
+                ++top.child_num;
+            }
+            stack_.push_back({Id(), entry->arity, 0});
+            ++counts_[count_index(entry->type, entry->arity)];
+            tokens_.push_back(entry);
+            expect_callable = false;
+            continue;
+        }
+
+        switch (token.type) {
+            case TokenParenLeft:
+                expect_callable = true;
+                break;
+            case TokenParenRight:
+                if (stack_.empty())
+                    error(Parser::ErrorUnexpectedRightParen, data, token.pos);
+                if (stack_.back().child_num < stack_.back().arity)
+                    error(Parser::ErrorNotEnoughArguments, data, token.pos);
+                stack_.pop_back();
+                if (stack_.empty())
+                    ++tree_num;
+                tokens_.push_back(nullptr);
+                break;
+            case TokenNumber:
+            case TokenSymbol: {
+                const Entry* entry = &number_entry_;
+                if (token.type == TokenNumber) {
+                    Value value;
+                    TokenError number_error = to_number(token, value);
+                    if (number_error.error != Parser::ErrorOk)
+                        error(number_error.error, data, number_error.pos);
+                    values_.push_back(value);
+                } else {
+                    entry = find_symbol(token.text);
+                    if (!entry)
+                        error(Parser::ErrorSymbolNotFound, data, token.pos);
+                    if (entry->is_callable)
+                        error(
+                            Parser::ErrorSymbolUnexpectedCallable,
+                            data, token.pos);
+                }
+                if (stack_.empty()) {
+                    ++tree_num;
+                } else {
+                    Frame& top = stack_.back();
+                    if (top.child_num == top.arity)
+                        error(Parser::ErrorTooManyArguments, data, token.pos);
+                    ++top.child_num;
+                }
+                ++counts_[count_index(entry->type, 0)];
+                tokens_.push_back(entry);
+                break;
+            }
+            case TokenEnd:
+                assert(false);
+        }
+    }
+    return tree_num;
+}
+
+void BulkParser::make(std::vector<Id>& roots) {
+    NodeManager& nm = env_->node_manager();
+    std::size_t value_num = 0;
+    stack_.clear();
+    for (const Entry* entry : tokens_) {
+        Id id;
+        if (!entry) {
+            // right paren
+            id = stack_.back().id;
+            stack_.pop_back();
+        } else if (entry->is_callable) {
+            id = make_node(*entry);
+            stack_.push_back({id, id.arity(), 0});
+            continue;
+        } else if (entry == &number_entry_) {
+            id = id::make(nm, TypeConst, 0);
+            id::set_value(nm, id, values_[value_num++]);
+        } else {
+            id = make_node(*entry);
+        }
+
+        // Add completed subtree to parent or result
+        if (stack_.empty()) {
+            roots.push_back(id);
+        } else {
+            Frame& top = stack_.back();
+            id::nth_argument(nm, top.id, top.child_num++) = id;
+        }
+    }
+}
+
+Id BulkParser::make_node(const Entry& entry) {
+    NodeManager& nm = env_->node_manager();
+    Id id = id::make(nm, entry.type, entry.arity);
+    switch (entry.type) {
+        case TypeConst:
+            id::set_value(nm, id, entry.value);
+            break;
+        case TypePositional:
+            id::set_position(nm, id, entry.index);
+            break;
+        case TypeFunction:
+            id::set_fid(nm, id, entry.index);
+            break;
+        case TypeSelect:
+            id::set_sfid(nm, id, entry.index);
+            break;
+        default:
+            assert(false);
+    }
+    return id;
+}
+
+void BulkParser::update_symbols() {
+    // Symbols are only added, make entries for new ones
+    const SymbolTable& symbols = env_->symbols();
+    for (std::size_t n = entries_.size(); n < symbols.size(); ++n) {
+        const SymbolPtr& symbol = symbols[n];
+        Entry entry{};
+        entry.type = symbol->type();
+        entry.arity = symbol->arity();
+        entry.is_callable = symbol->is_callable();
+        switch (symbol->type()) {
+            case TypeConst:
+                entry.value = symbol->value();
+                break;
+            case TypePositional:
+                entry.index = symbol->position();
+                break;
+            case TypeFunction:
+                entry.index = symbol->fid();
+                break;
+            case TypeSelect:
+                entry.index = symbol->sfid();
+                break;
+            default:
+                assert(false);
+        }
+        entries_.push_back(entry);
+    }
+}
+
+const BulkParser::Entry* BulkParser::find_symbol(std::string_view name) const {
+    std::size_t index = env_->symbols().find_index(name);
+    return (index < entries_.size()) ? &entries_[index] : nullptr;
+}
+
+void BulkParser::error(
+    Parser::Error error,
+    const char* data,
+    std::size_t pos) const
+{
+    // Count position only when reporting error
+    std::size_t line_num = 1;
+    std::size_t line_start = 0;
+    for (std::size_t n = 0; n < pos; ++n) {
+        if (data[n] == '\n') {
+            ++line_num;
+            line_start = n + 1;
+        }
+    }
+    throw ParserError(
+        Parser::error_message(error),
+        line_num,
+        pos - line_start + 1);
+}
+
+} // namespace stree
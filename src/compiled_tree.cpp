@@ -0,0 +1,169 @@
+#include <stree/compiled_tree.hpp>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace stree {
+
+CompiledTree::CompiledTree(const Environment& env, const Id& root)
+    : env_(&env),
+      stack_size_(0),
+      stack_size_max_(0)
+{
+    if (!id::is_valid_subtree(env_->node_manager(), root))
+        throw std::invalid_argument("Cannot compile invalid subtree");
+    compile(root);
+    assert(stack_size_ == 1);
+    stack_.resize(stack_size_max_);
+}
+
+Value CompiledTree::eval(const Params& params, DataPtr data) const {
+    Value* top = stack_.data(); // next free stack slot
+    Address pc = 0;
+    while (pc < instructions_.size()) {
+        const Instruction& instruction = instructions_[pc];
+        switch (instruction.opcode) {
+            case OpConst:
+                *(top++) = instruction.value;
+                ++pc;
+                break;
+            case OpPositional:
+                assert(
+                    instruction.position < params.size()
+                    && "Invalid positional argument index");
+                *(top++) = params[instruction.position];
+                ++pc;
+                break;
+            case OpFunction: {
+                top -= instruction.argument_num;
+                *top = context_.call_function(
+                    *env_,
+                    instruction.fid,
+                    ArgumentSpan(top, instruction.argument_num),
+                    data);
+                ++top;
+                ++pc;
+                break;
+            }
+            case OpSelect: {
+                top -= instruction.argument_num;
+                unsigned branch = context_.call_select_function(
+                    *env_,
+                    instruction.sfid,
+                    ArgumentSpan(top, instruction.argument_num),
+                    data);
+                assert(branch < instruction.arity && "Invalid branch selected");
+                if (branch < instruction.argument_num) {
+                    *top = top[branch];
+                    ++top;
+                }
+                pc = branches_[instruction.jump + branch];
+                break;
+            }
+            case OpJump:
+                pc = instruction.jump;
+                break;
+        }
+    }
+    assert(top == stack_.data() + 1);
+    return stack_[0];
+}
+
+void CompiledTree::compile(const Id& id) {
+    Instruction instruction{};
+    instruction.arity = id.arity();
+    switch (id.type()) {
+        case TypeConst:
+            instruction.opcode = OpConst;
+            instruction.value = id::value(env_->node_manager(), id);
+            emit(instruction);
+            push();
+            break;
+        case TypePositional:
+            instruction.opcode = OpPositional;
+            instruction.position = id::position(env_->node_manager(), id);
+            emit(instruction);
+            push();
+            break;
+        case TypeFunction:
+            for (Arity n = 0; n < id.arity(); ++n)
+                compile(id::nth_argument(env_->node_manager(), id, n));
+            instruction.opcode = OpFunction;
+            instruction.argument_num = id.arity();
+            instruction.fid = id::fid(env_->node_manager(), id);
+            emit(instruction);
+            pop(instruction.argument_num);
+            push();
+            break;
+        case TypeSelect:
+            compile_select(id);
+            break;
+    }
+}
+
+/*
+  Select layout:
+    <argument 0> ... <argument N-1>  ; N = select function arity
+    select                           ; jump to branch address
+    <branch N>
+    jump end
+    ...
+    <branch arity-1>
+  end:
+*/
+void CompiledTree::compile_select(const Id& id) {
+    Arity argument_num = get_argument_num(*env_, id);
+    for (Arity n = 0; n < argument_num; ++n)
+        compile(id::nth_argument(env_->node_manager(), id, n));
+
+    Instruction instruction{};
+    instruction.opcode = OpSelect;
+    instruction.arity = id.arity();
+    instruction.argument_num = argument_num;
+    instruction.sfid = id::sfid(env_->node_manager(), id);
+    instruction.jump = branches_.size();
+    emit(instruction);
+    pop(argument_num);
+
+    // Reserve branch table
+    std::size_t table = branches_.size();
+    branches_.resize(table + id.arity());
+
+    // Compile branches not evaluated as select function arguments
+    AddressList jumps;
+    for (Arity n = argument_num; n < id.arity(); ++n) {
+        branches_[table + n] = instructions_.size();
+        compile(id::nth_argument(env_->node_manager(), id, n));
+        pop(1); // only one branch value is left on stack
+        if (n + 1 < id.arity()) {
+            Instruction jump{};
+            jump.opcode = OpJump;
+            jumps.push_back(emit(jump));
+        }
+    }
+    push();
+
+    // Set end address
+    Address end = instructions_.size();
+    for (Address address : jumps)
+        instructions_[address].jump = end;
+    for (Arity n = 0; n < argument_num; ++n)
+        branches_[table + n] = end;
+}
+
+CompiledTree::Address CompiledTree::emit(Instruction instruction) {
+    instructions_.push_back(instruction);
+    return instructions_.size() - 1;
+}
+
+void CompiledTree::push(unsigned n) {
+    stack_size_ += n;
+    stack_size_max_ = std::max(stack_size_max_, stack_size_);
+}
+
+void CompiledTree::pop(unsigned n) {
+    assert(stack_size_ >= n);
+    stack_size_ -= n;
+}
+
+} // namespace stree
@@ -3,6 +3,7 @@
 #include <memory>
 #include <stdexcept>
 #include <utility>
+#include <stree/tree.hpp>
 
 namespace stree {
 
@@ -13,10 +14,67 @@ void Environment::add_function(
     Arity arity,
     Function function,
     Cost cost)
+{
+    add_function(name, arity, std::move(function), BatchFunction(), cost);
+}
+
+void Environment::add_function(
+    const std::string& name,
+    Arity arity,
+    Function function,
+    BatchFunction batch_function,
+    Cost cost)
+{
+    add_function(
+        name,
+        arity,
+        std::move(function),
+        SpanFunction(),
+        std::move(batch_function),
+        cost);
+}
+
+void Environment::add_span_function(
+    const std::string& name,
+    Arity arity,
+    SpanFunction function,
+    Cost cost)
+{
+    add_span_function(name, arity, std::move(function), BatchFunction(), cost);
+}
+
+void Environment::add_span_function(
+    const std::string& name,
+    Arity arity,
+    SpanFunction function,
+    BatchFunction batch_function,
+    Cost cost)
+{
+    Function adapter = [function](const Arguments& args, DataPtr data) {
+        return function(ArgumentSpan(args), data);
+    };
+    add_function(
+        name,
+        arity,
+        std::move(adapter),
+        std::move(function),
+        std::move(batch_function),
+        cost);
+}
+
+void Environment::add_function(
+    const std::string& name,
+    Arity arity,
+    Function function,
+    SpanFunction span_function,
+    BatchFunction batch_function,
+    Cost cost)
 {
     // Add function
     FunctionIndex fid = functions_.size();
-    functions_.push_back(function);
+    functions_.push_back(std::move(function));
+    span_functions_.push_back(std::move(span_function));
+    batch_functions_.push_back(std::move(batch_function));
 
     // Add symbol
     SymbolPtr symbol = make_symbol(name, TypeFunction);
@@ -26,20 +84,74 @@ void Environment::add_function(
     add_symbol(symbol);
 }
 
-Function Environment::function(FunctionIndex fid) const {
+const Function& Environment::function(FunctionIndex fid) const {
     return functions_.at(fid);
 }
 
+bool Environment::has_span_function(FunctionIndex fid) const {
+    return static_cast<bool>(span_functions_.at(fid));
+}
+
+const SpanFunction& Environment::span_function(FunctionIndex fid) const {
+    return span_functions_.at(fid);
+}
+
+bool Environment::has_batch_function(FunctionIndex fid) const {
+    return static_cast<bool>(batch_functions_.at(fid));
+}
+
+const BatchFunction& Environment::batch_function(FunctionIndex fid) const {
+    return batch_functions_.at(fid);
+}
+
+void Environment::add_select_function(
+        const std::string& name,
+        Arity arity,
+        Arity sf_arity,
+        SelectFunction select_function,
+        Cost cost)
+{
+    add_select_function(
+        name,
+        arity,
+        sf_arity,
+        std::move(select_function),
+        SpanSelectFunction(),
+        cost);
+}
+
+void Environment::add_span_select_function(
+        const std::string& name,
+        Arity arity,
+        Arity sf_arity,
+        SpanSelectFunction select_function,
+        Cost cost)
+{
+    SelectFunction adapter =
+        [select_function](const Arguments& args, DataPtr data) {
+            return select_function(ArgumentSpan(args), data);
+        };
+    add_select_function(
+        name,
+        arity,
+        sf_arity,
+        std::move(adapter),
+        std::move(select_function),
+        cost);
+}
+
 void Environment::add_select_function(
         const std::string& name,
         Arity arity,
         Arity sf_arity,
         SelectFunction select_function,
+        SpanSelectFunction span_select_function,
         Cost cost)
 {
     // Add select function
     SelectFunctionIndex sfid = select_functions_.size();
-    select_functions_.push_back(select_function);
+    select_functions_.push_back(std::move(select_function));
+    span_select_functions_.push_back(std::move(span_select_function));
 
     // Add symbol
     SymbolPtr symbol = make_symbol(name, TypeSelect);
@@ -50,10 +162,22 @@ void Environment::add_select_function(
     add_symbol(symbol);
 }
 
-SelectFunction Environment::select_function(SelectFunctionIndex sfid) const {
+const SelectFunction& Environment::select_function(
+    SelectFunctionIndex sfid) const
+{
     return select_functions_.at(sfid);
 }
 
+bool Environment::has_span_select_function(SelectFunctionIndex sfid) const {
+    return static_cast<bool>(span_select_functions_.at(sfid));
+}
+
+const SpanSelectFunction& Environment::span_select_function(
+    SelectFunctionIndex sfid) const
+{
+    return span_select_functions_.at(sfid);
+}
+
 void Environment::add_positional(const std::string& name, Position position) {
     SymbolPtr symbol = make_symbol(name, TypePositional);
     symbol->set_position(position);
@@ -106,4 +230,60 @@ void Environment::add_symbol(const SymbolPtr& symbol) {
     symbol_table_.add(symbol);
 }
 
+std::unique_ptr<Environment> Environment::make_shard() const {
+    std::unique_ptr<Environment> shard(new Environment());
+    shard->origin_ = origin_;
+    shard->functions_ = functions_;
+    shard->span_functions_ = span_functions_;
+    shard->batch_functions_ = batch_functions_;
+    shard->select_functions_ = select_functions_;
+    shard->span_select_functions_ = span_select_functions_;
+    for (std::size_t n = 0; n < symbol_table_.size(); ++n)
+        shard->add_symbol(symbol_table_[n]);
+    return shard;
+}
+
+std::vector<Tree> Environment::merge(
+    Environment& shard,
+    std::vector<Tree>&& trees)
+{
+    if (shard.origin_ != origin_ || symbols().size() != shard.symbols().size())
+        throw std::invalid_argument(
+            "Cannot merge environments with different symbols");
+    // Check all trees before moving roots, so trees are left
+    // intact on error
+    for (const Tree& tree : trees)
+        if (tree.env() != &shard)
+            throw std::invalid_argument("Tree does not belong to shard");
+    std::vector<Id> roots;
+    roots.reserve(trees.size());
+    for (Tree& tree : trees)
+        roots.push_back(id::move(tree.root()));
+    trees.clear();
+    node_manager_.merge(shard.node_manager_, roots);
+
+    std::vector<Tree> result;
+    result.reserve(roots.size());
+    for (const Id& root : roots)
+        result.emplace_back(this, root);
+    return result;
+}
+
+void Environment::compact(std::vector<Tree>& trees, NodeOrder order) {
+    std::vector<Id> roots;
+    roots.reserve(trees.size());
+    for (Tree& tree : trees) {
+        if (tree.env() != this)
+            throw std::invalid_argument(
+                "Tree does not belong to environment");
+        roots.push_back(tree.root());
+    }
+    node_manager_.compact(roots, order);
+    for (std::size_t n = 0; n < trees.size(); ++n) {
+        trees[n].root() = roots[n];
+        // Node IDs are changed, cached index is keyed by ID
+        trees[n].reset_cache();
+    }
+}
+
 } // namespace stree {
@@ -1,18 +1,39 @@
 #include <stree/environment/symbol_table.hpp>
-#include <stdexcept>
+#include <algorithm>
 #include <cassert>
+#include <stdexcept>
 #include <stree/node.hpp>
 #include <stree/environment.hpp>
 
 namespace stree {
 
+namespace {
+
+// FNV-1a
+std::size_t hash_name(std::string_view name) {
+    std::uint32_t h = 2166136261u;
+    for (char c : name) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+} // namespace
+
+
+const SymbolPtr SymbolTable::NoSymbol;
+
 void SymbolTable::add(const SymbolPtr& symbol) {
     assert(symbol);
-    add_to_map(symbol);
+    if (find(symbol->name()))
+        throw std::out_of_range(
+            std::string("Symbol `") + symbol->name() + "' already exists");
+    add_to_type_map(symbol);
     add_to_list(symbol);
+    add_to_name_table(symbol);
     add_to_term_list(symbol);
     add_to_arity_list(symbol);
-    add_to_type_map(symbol);
 }
 
 const SymbolPtr& SymbolTable::operator[](std::size_t n) const {
@@ -35,30 +56,22 @@ const SymbolPtr& SymbolTable::by_id(const Id& id) const {
         case TypeConst:
             // ?? or just return empty ptr?
             throw std::invalid_argument("Cannot find symbol for constant");
-
-        case TypePositional: {
-            Position position = id::position(env_->node_manager(), id);
-            return by_position(position);
-        }
-        case TypeFunction: {
-            FunctionIndex fid = id::fid(env_->node_manager(), id);
-            return by_fid(fid);
-        }
-        case TypeSelect: {
-            SelectFunctionIndex sfid = id::sfid(env_->node_manager(), id);
-            return by_sfid(sfid);
-        }
+        case TypePositional:
+            return by_position(id::position(env_->node_manager(), id));
+        case TypeFunction:
+            return by_fid(id::fid(env_->node_manager(), id));
+        case TypeSelect:
+            return by_sfid(id::sfid(env_->node_manager(), id));
     }
     assert(false);
 }
 
 const SymbolPtr& SymbolTable::by_name(const std::string& name) const {
-    try {
-        return map_.at(name);
-    } catch (std::out_of_range& e) {
+    const SymbolPtr& symbol = find(name);
+    if (!symbol)
         throw std::out_of_range(
-            std::string("Symbol `") + "' not found");
-    }
+            std::string("Symbol `") + name + "' not found");
+    return symbol;
 }
 
 // NOTE: throws if arity list not found
@@ -74,44 +87,87 @@ const SymbolPtrList& SymbolTable::list_by_arity(const Arity arity) const {
 }
 
 const SymbolPtr& SymbolTable::by_position(Position position) const {
-    try {
-        return positional_map_.at(position);
-    } catch (std::out_of_range& e) {
+    const SymbolPtr& symbol = find_by_position(position);
+    if (!symbol)
         throw std::out_of_range(
             std::string("Positional with position ")
             + std::to_string(static_cast<unsigned>(position))
             + " not found");
-    }
+    return symbol;
 }
 
 const SymbolPtr& SymbolTable::by_fid(FunctionIndex fid) const {
-    try {
-        return function_map_.at(fid);
-    } catch (std::out_of_range& e) {
+    const SymbolPtr& symbol = find_by_fid(fid);
+    if (!symbol)
         throw std::out_of_range(
             std::string("Function with fid ")
             + std::to_string(static_cast<unsigned>(fid))
             + " not found");
-    }
+    return symbol;
 }
 
 const SymbolPtr& SymbolTable::by_sfid(SelectFunctionIndex sfid) const {
-    try {
-        return select_function_map_.at(sfid);
-    } catch (std::out_of_range& e) {
+    const SymbolPtr& symbol = find_by_sfid(sfid);
+    if (!symbol)
         throw std::out_of_range(
             std::string("Select function with sfid ")
             + std::to_string(static_cast<unsigned>(sfid))
             + " not found");
+    return symbol;
+}
+
+const SymbolPtr& SymbolTable::find_by_id(const Id& id) const {
+    switch (id.type()) {
+        case TypeConst:
+            return NoSymbol;
+        case TypePositional:
+            return find_by_position(id::position(env_->node_manager(), id));
+        case TypeFunction:
+            return find_by_fid(id::fid(env_->node_manager(), id));
+        case TypeSelect:
+            return find_by_sfid(id::sfid(env_->node_manager(), id));
     }
+    assert(false);
 }
 
+const SymbolPtr& SymbolTable::find(std::string_view name) const {
+    std::size_t index = find_index(name);
+    return (index != NoIndex) ? list_[index] : NoSymbol;
+}
 
-void SymbolTable::add_to_map(const SymbolPtr& symbol) {
-    if (map_.count(symbol->name()) > 0)
-        throw std::out_of_range(
-            std::string("Symbol `") + symbol->name() + "' already exists");
-    map_[symbol->name()] = symbol;
+std::size_t SymbolTable::find_index(std::string_view name) const {
+    if (name_table_.empty())
+        return NoIndex;
+    std::size_t mask = name_table_.size() - 1;
+    for (std::size_t slot = hash_name(name) & mask; ;
+         slot = (slot + 1) & mask)
+    {
+        std::uint32_t index = name_table_[slot];
+        if (index == 0)
+            return NoIndex;
+        if (list_[index - 1]->name() == name)
+            return index - 1;
+    }
+}
+
+void SymbolTable::add_to_name_table(const SymbolPtr& symbol) {
+    assert(!list_.empty() && list_.back() == symbol);
+    // Keep load factor below 1/2
+    if (name_table_.size() < list_.size() * 2) {
+        name_table_.assign(std::max<std::size_t>(16, name_table_.size() * 2), 0);
+        for (std::uint32_t n = 0; n < list_.size(); ++n)
+            insert_to_name_table(n);
+    } else {
+        insert_to_name_table(list_.size() - 1);
+    }
+}
+
+void SymbolTable::insert_to_name_table(std::uint32_t index) {
+    std::size_t mask = name_table_.size() - 1;
+    std::size_t slot = hash_name(list_[index]->name()) & mask;
+    while (name_table_[slot] != 0)
+        slot = (slot + 1) & mask;
+    name_table_[slot] = index + 1;
 }
 
 void SymbolTable::add_to_list(const SymbolPtr& symbol) {
@@ -136,46 +192,39 @@ void SymbolTable::add_to_type_map(const SymbolPtr& symbol) {
             // do nothing
             break;
         case TypePositional:
-            add_to_positional_map(symbol);
+            add_to_index_table(
+                positionals_, symbol->position(), symbol,
+                "Positional", "position");
             break;
         case TypeFunction:
-            add_to_function_map(symbol);
+            add_to_index_table(
+                functions_, symbol->fid(), symbol,
+                "Function", "fid");
             break;
         case TypeSelect:
-            add_to_select_function_map(symbol);
+            add_to_index_table(
+                select_functions_, symbol->sfid(), symbol,
+                "Select function", "sfid");
             break;
     }
 }
 
 // NOTE: aliases should probably be allowed in future (for other types too?)
-void SymbolTable::add_to_positional_map(const SymbolPtr& symbol) {
-    assert(symbol->type() == TypePositional);
-    if (positional_map_.count(symbol->position()) > 0)
-        throw std::out_of_range(
-            std::string("Positional with position ")
-            + std::to_string(static_cast<unsigned>(symbol->position()))
-            + " already exists");
-    positional_map_[symbol->position()] = symbol;
-}
-
-void SymbolTable::add_to_function_map(const SymbolPtr& symbol) {
-    assert(symbol->type() == TypeFunction);
-    if (function_map_.count(symbol->fid()) > 0)
+void SymbolTable::add_to_index_table(
+    SymbolPtrList& table,
+    std::uint8_t index,
+    const SymbolPtr& symbol,
+    const char* kind,
+    const char* index_name)
+{
+    if (index < table.size() && table[index])
         throw std::out_of_range(
-            std::string("Function with fid ")
-            + std::to_string(static_cast<unsigned>(symbol->fid()))
-            + " already exists");
-    function_map_[symbol->fid()] = symbol;
-}
-
-void SymbolTable::add_to_select_function_map(const SymbolPtr& symbol) {
-    assert(symbol->type() == TypeSelect);
-    if (select_function_map_.count(symbol->sfid()) > 0)
-        throw std::out_of_range(
-            std::string("Select function with sfid ")
-            + std::to_string(static_cast<unsigned>(symbol->sfid()))
+            std::string(kind) + " with " + index_name + " "
+            + std::to_string(static_cast<unsigned>(index))
             + " already exists");
-    select_function_map_[symbol->sfid()] = symbol;
+    if (index >= table.size())
+        table.resize(index + 1);
+    table[index] = symbol;
 }
 
 }
@@ -1,35 +1,41 @@
 #include <stree/eval.hpp>
+#include <algorithm>
 #include <cassert>
+#include <vector>
 
 namespace stree {
 
-namespace {
+// EvalContext
 
-Arguments eval_arguments(
+Value EvalContext::call_function(
     const Environment& env,
-    const Id& id,
-    const Params& params, DataPtr data)
+    FunctionIndex fid,
+    ArgumentSpan arguments,
+    DataPtr data)
 {
-    Arity argument_num = get_argument_num(env, id);
-    Arguments arguments(argument_num);
-    for (Arity n = 0; n < argument_num; ++n)
-        arguments[n] = eval(
-            env,
-            id::nth_argument(env.node_manager(), id, n),
-            params, data);
-    return arguments;
+    if (env.has_span_function(fid))
+        return env.span_function(fid)(arguments, data);
+    arguments_.assign(arguments.begin(), arguments.end());
+    return env.function(fid)(arguments_, data);
 }
 
+unsigned EvalContext::call_select_function(
+    const Environment& env,
+    SelectFunctionIndex sfid,
+    ArgumentSpan arguments,
+    DataPtr data)
+{
+    if (env.has_span_select_function(sfid))
+        return env.span_select_function(sfid)(arguments, data);
+    arguments_.assign(arguments.begin(), arguments.end());
+    return env.select_function(sfid)(arguments_, data);
 }
 
-Value eval(
+Value EvalContext::eval_node(
     const Environment& env,
     const Id& id,
     const Params& params, DataPtr data)
 {
-    assert(
-        id::is_valid_subtree(env.node_manager(), id)
-        && "Cannot eval invalid subtree");
     switch (id.type()) {
         case TypeConst: {
             return id::value(env.node_manager(), id);
@@ -42,29 +48,96 @@ Value eval(
         }
         case TypeFunction: {
             // eval arguments
-            Arguments args = eval_arguments(env, id, params, data);
+            Arity argument_num = id.arity();
+            std::size_t base = push_arguments(
+                env, id, argument_num, params, data);
             // apply function
-            return call_function(env, id, args, data);
+            Value value = call_function(
+                env,
+                id::fid(env.node_manager(), id),
+                ArgumentSpan(stack_.data() + base, argument_num),
+                data);
+            stack_.resize(base);
+            return value;
         }
         case TypeSelect: {
-            Arguments args = eval_arguments(env, id, params, data);
-            unsigned branch = call_select_function(env, id, args, data);
+            Arity argument_num = get_argument_num(env, id);
+            std::size_t base = push_arguments(
+                env, id, argument_num, params, data);
+            unsigned branch = call_select_function(
+                env,
+                id::sfid(env.node_manager(), id),
+                ArgumentSpan(stack_.data() + base, argument_num),
+                data);
             assert(branch < id.arity() && "Invalid branch selected");
-            return (branch < args.size())
-                ? args[branch]
-                : eval(
-                    env, id::nth_argument(env.node_manager(), id, branch),
-                    params, data);
-
+            if (branch < argument_num) {
+                Value value = stack_[base + branch];
+                stack_.resize(base);
+                return value;
+            }
+            stack_.resize(base);
+            return eval_node(
+                env, id::nth_argument(env.node_manager(), id, branch),
+                params, data);
         }
     }
     assert(false);
 }
 
+std::size_t EvalContext::push_arguments(
+    const Environment& env,
+    const Id& id,
+    Arity argument_num,
+    const Params& params, DataPtr data)
+{
+    std::size_t base = stack_.size();
+    for (Arity n = 0; n < argument_num; ++n) {
+        // NOTE: evaluate before pushing, stack may be reallocated
+        Value value = eval_node(
+            env,
+            id::nth_argument(env.node_manager(), id, n),
+            params, data);
+        stack_.push_back(value);
+    }
+    return base;
+}
+
+
+Value eval(
+    const Environment& env,
+    const Id& id,
+    const Params& params, DataPtr data)
+{
+    EvalContext context;
+    return eval(context, env, id, params, data);
+}
+
 Value eval(const Tree& tree, const Params& params, DataPtr data) {
     return eval(*tree.env(), tree.root(), params, data);
 }
 
+Value eval(
+    EvalContext& context,
+    const Environment& env,
+    const Id& id,
+    const Params& params, DataPtr data)
+{
+    assert(
+        id::is_valid_subtree(env.node_manager(), id)
+        && "Cannot eval invalid subtree");
+    // stack may be left non-empty by exception thrown from function
+    context.stack_.clear();
+    return context.eval_node(env, id, params, data);
+}
+
+Value eval(
+    EvalContext& context,
+    const Tree& tree,
+    const Params& params, DataPtr data)
+{
+    return eval(context, *tree.env(), tree.root(), params, data);
+}
+
 
 Arity get_argument_num(const Environment& env, const Id& id) {
     Arity n = id.arity();
@@ -101,4 +174,85 @@ unsigned call_select_function(
     return branch;
 }
 
+TreeCostBound cost_bound(const Environment& env, const Id& id) {
+    struct Frame {
+        Id id;
+        Arity argument_num;
+        Arity next;
+        TreeCostBound bound;
+        // Selected branch bounds
+        bool has_branch;
+        Cost branch_min;
+        Cost branch_max;
+    };
+
+    TreeCostBound result;
+    result.set_zero();
+    if (id.empty())
+        return result;
+
+    const NodeManager& nm = env.node_manager();
+    std::vector<Frame> stack;
+    auto push = [&env, &stack](const Id& id) {
+        Frame frame;
+        frame.id = id;
+        frame.argument_num = get_argument_num(env, id);
+        frame.next = 0;
+        frame.bound.set_zero();
+        if (id.type() != TypeConst) {
+            Cost cost = env.symbols().by_id(id)->cost();
+            frame.bound.min = frame.bound.max = cost;
+        }
+        if (id.type() == TypeSelect) {
+            frame.bound.select_num = 1;
+            // Select function may choose one of evaluated arguments
+            frame.has_branch = (frame.argument_num > 0);
+        } else {
+            frame.has_branch = false;
+        }
+        frame.branch_min = frame.branch_max = 0;
+        stack.push_back(frame);
+    };
+
+    push(id);
+    while (true) {
+        Frame& top = stack.back();
+        if (top.next < top.id.arity()) {
+            // Push next child
+            Id child = id::nth_argument(nm, top.id, top.next++);
+            push(child);
+            continue;
+        }
+
+        TreeCostBound bound = top.bound;
+        if (top.id.type() == TypeSelect) {
+            bound.min += top.branch_min;
+            bound.max += top.branch_max;
+        }
+        stack.pop_back();
+        if (stack.empty()) {
+            result = bound;
+            break;
+        }
+
+        // Add to parent
+        Frame& parent = stack.back();
+        parent.bound.select_num += bound.select_num;
+        if (parent.next <= parent.argument_num) {
+            // argument, always evaluated
+            parent.bound.min += bound.min;
+            parent.bound.max += bound.max;
+        } else if (!parent.has_branch) {
+            // first branch
+            parent.has_branch = true;
+            parent.branch_min = bound.min;
+            parent.branch_max = bound.max;
+        } else {
+            parent.branch_min = std::min(parent.branch_min, bound.min);
+            parent.branch_max = std::max(parent.branch_max, bound.max);
+        }
+    }
+    return result;
+}
+
 }
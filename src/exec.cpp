@@ -1,5 +1,7 @@
 #include <stree/exec.hpp>
+#include <algorithm>
 #include <cassert>
+#include <unordered_map>
 
 namespace stree {
 
@@ -14,64 +16,82 @@ void Exec::init(Params* params, DataPtr data_ptr) {
     restart();
 }
 
-void Exec::run() {
+Exec::Status Exec::run() {
     bool loop = has_flag(FlagRunLoop);
-    while (loop || !is_finished())
-        step();
+    while (loop || !is_finished()) {
+        if (step() != StatusOk)
+            break;
+    }
+    return status_;
 }
 
-void Exec::step() {
-    if (is_finished())
-        restart();
+Exec::Status Exec::step() {
+    status_ = StatusOk;
+    while (true) {
+        if (is_finished())
+            restart();
 
-    Frame& current = stack_top();
-    if (current.arguments.size() == current.argument_num) {
-        // Arguments evaluated, evaluate top
-        eval_top();
-    } else {
-        // Push next argument
-        push_argument();
+        Frame& current = stack_top();
+        if (top_argument_num() < current.argument_num) {
+            // Push next argument
+            push_argument();
+        } else if (eval_top()) {
+            // Arguments evaluated, top evaluated
+            // or cost limit exceeded
+            break;
+        }
     }
+    return status_;
 }
 
-void Exec::eval_top() {
+bool Exec::eval_top() {
     Frame& current = stack_top();
 
     // Check cost
     Cost cost = 0;
-    SymbolPtr symbol;
+    const Symbol* symbol = nullptr;
     if (current.id.type() != TypeConst) {
-        symbol = env_.symbols().by_id(current.id);
+        symbol = env_.symbols().by_id(current.id).get();
         cost = symbol->cost();
     }
     if (has_cost_limit() && (cost_used_ + cost) > cost_limit_) {
-        throw ExecCostLimitExceeded();
+        if (!has_flag(FlagNoThrow))
+            throw ExecCostLimitExceeded();
+        // Stop, top frame is not evaluated
+        status_ = StatusCostLimitExceeded;
+        return true;
     }
 
+    const NodeManager& nm = env_.node_manager();
+    ArgumentSpan arguments(values_.data() + current.base, top_argument_num());
     switch (current.id.type()) {
         case TypeConst:
+            stack_return(id::value(nm, current.id));
+            break;
         case TypePositional: {
-            Value value = eval(env_, current.id, *params_, data_ptr_);
-            stack_return(value);
+            Position position = id::position(nm, current.id);
+            assert(
+                position < params_->size()
+                && "Invalid positional argument index");
+            stack_return((*params_)[position]);
             break;
         }
         case TypeFunction: {
-            Value value = call_function(
-                env_, current.id, current.arguments, data_ptr_);
+            Value value = context_.call_function(
+                env_, id::fid(nm, current.id), arguments, data_ptr_);
             stack_return(value);
             break;
         }
         case TypeSelect: {
-            unsigned branch = call_select_function(
-                env_, current.id, current.arguments, data_ptr_);
-            if (branch < current.arguments.size()) {
+            unsigned branch = context_.call_select_function(
+                env_, id::sfid(nm, current.id), arguments, data_ptr_);
+            assert(branch < current.id.arity() && "Invalid branch selected");
+            if (branch < arguments.size()) {
                 // branch already evaluated as select function argument
-                Value value = current.arguments[branch];
-                stack_return(value);
+                stack_return(arguments[branch]);
             } else {
                 // push selected branch
-                Id branch_id = id::nth_argument(
-                    env_.node_manager(), current.id, branch);
+                Id branch_id = id::nth_argument(nm, current.id, branch);
                 stack_pop();
                 stack_push(branch_id);
             }
@@ -90,17 +110,16 @@ void Exec::eval_top() {
         stop |= (symbol->type() == TypeFunction && has_flag(FlagStopOnFunctions));
         stop |= (symbol->type() == TypeSelect && has_flag(FlagStopOnSelects));
     }
-    if (!stop) step();
+    return stop;
 }
 
 void Exec::push_argument() {
     Frame& current = stack_top();
-    const Id& id = id::nth_argument(
+    Id id = id::nth_argument(
         env_.node_manager(),
         current.id,
-        current.arguments.size());
+        top_argument_num());
     stack_push(id);
-    step();
 }
 
 void Exec::restart() {
@@ -109,13 +128,243 @@ void Exec::restart() {
     is_finished_ = false;
 }
 
+ExecSnapshot Exec::snapshot() {
+    // Freeze local stack
+    if (!stack_.empty()) {
+        auto segment = std::make_shared<Segment>();
+        segment->parent = std::move(frozen_);
+        segment->frames = stack_;
+        segment->values = values_;
+        frozen_.frame_num = segment->frames.size();
+        frozen_.segment = std::move(segment);
+        stack_.clear();
+        values_.clear();
+    }
+    ExecSnapshot snapshot;
+    snapshot.root_ = root_;
+    snapshot.stack_ = frozen_;
+    snapshot.cost_used_ = cost_used_;
+    snapshot.is_finished_ = is_finished_;
+    snapshot.result_ = result_;
+    return snapshot;
+}
+
+void Exec::restore(const ExecSnapshot& snapshot) {
+    if (!(snapshot.root_ == root_))
+        throw std::invalid_argument("Snapshot is made for other tree");
+    stack_clear();
+    frozen_ = snapshot.stack_;
+    cost_used_ = snapshot.cost_used_;
+    status_ = StatusOk;
+    is_finished_ = snapshot.is_finished_;
+    result_ = snapshot.result_;
+}
+
+Exec Exec::fork() {
+    Exec exec(env_, root_, flags_);
+    exec.params_ = params_;
+    exec.data_ptr_ = data_ptr_;
+    exec.cost_limit_ = cost_limit_;
+    exec.restore(snapshot());
+    return exec;
+}
+
+
+namespace {
+
+const char SnapshotMagic[8] = {'S', 'T', 'R', 'E', 'E', 'E', 'X', 'S'};
+const std::uint32_t SnapshotVersion = 1;
+
+template<typename T>
+void write_value(std::ostream& os, const T& value) {
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename T>
+T read_value(std::istream& is) {
+    T value{};
+    if (!is.read(reinterpret_cast<char*>(&value), sizeof(value)))
+        throw std::runtime_error("Invalid exec snapshot: unexpected end");
+    return value;
+}
+
+[[noreturn]] void throw_invalid_snapshot(const std::string& message) {
+    throw std::runtime_error("Invalid exec snapshot: " + message);
+}
+
+// Frame is pushed for node or, if node is a select,
+// for its branch replacing select frame
+bool is_pushed_for(const Environment& env, const Id& node, const Id& id) {
+    const NodeManager& nm = env.node_manager();
+    std::vector<Id> nodes{node};
+    while (!nodes.empty()) {
+        Id current = nodes.back();
+        nodes.pop_back();
+        if (current == id)
+            return true;
+        if (current.type() != TypeSelect)
+            continue;
+        Arity branch = get_argument_num(env, current);
+        for (; branch < current.arity(); ++branch)
+            nodes.push_back(id::nth_argument(nm, current, branch));
+    }
+    return false;
+}
+
+} // namespace
+
+void Exec::save(std::ostream& os) {
+    std::vector<std::pair<Frame, ArgumentSpan>> stack = frames();
+
+    // Node numbers of frames
+    std::unordered_map<Id, std::vector<std::size_t>> frame_nums;
+    for (std::size_t n = 0; n < stack.size(); ++n)
+        frame_nums[stack[n].first.id].push_back(n);
+    std::vector<std::uint64_t> node_nums(stack.size());
+    std::size_t found_num = 0;
+    if (!stack.empty()) {
+        id::for_each_node(
+            env_.node_manager(), root_,
+            [&](const Id& id, NodeNum n, NodeNum) {
+                auto it = frame_nums.find(id);
+                if (it != frame_nums.end()) {
+                    for (std::size_t frame : it->second)
+                        node_nums[frame] = n;
+                    found_num += it->second.size();
+                }
+                return found_num == stack.size();
+            });
+    }
+    assert(found_num == stack.size());
+
+    os.write(SnapshotMagic, sizeof(SnapshotMagic));
+    write_value(os, SnapshotVersion);
+    write_value(os, static_cast<std::uint8_t>(is_finished_));
+    write_value(os, result_);
+    write_value(os, cost_used_);
+    write_value(os, static_cast<std::uint64_t>(stack.size()));
+    for (std::size_t n = 0; n < stack.size(); ++n) {
+        ArgumentSpan arguments = stack[n].second;
+        write_value(os, node_nums[n]);
+        write_value(os, static_cast<std::uint8_t>(arguments.size()));
+        for (const Value& value : arguments)
+            write_value(os, value);
+    }
+    if (!os)
+        throw std::runtime_error("Failed to write exec snapshot");
+}
+
+void Exec::load(std::istream& is) {
+    char magic[sizeof(SnapshotMagic)];
+    if (!is.read(magic, sizeof(magic))
+        || !std::equal(magic, magic + sizeof(magic), SnapshotMagic))
+        throw_invalid_snapshot("wrong magic number");
+    if (read_value<std::uint32_t>(is) != SnapshotVersion)
+        throw_invalid_snapshot("unsupported version");
+
+    ExecSnapshot snapshot;
+    snapshot.root_ = root_;
+    snapshot.is_finished_ = read_value<std::uint8_t>(is);
+    snapshot.result_ = read_value<Value>(is);
+    snapshot.cost_used_ = read_value<Cost>(is);
+
+    // Read frames to single segment
+    auto segment = std::make_shared<Segment>();
+    std::uint64_t frame_num = read_value<std::uint64_t>(is);
+    if (!snapshot.is_finished_ && frame_num == 0)
+        throw_invalid_snapshot("no frames left before finish");
+    std::vector<std::uint64_t> node_nums;
+    for (std::uint64_t n = 0; n < frame_num; ++n) {
+        node_nums.push_back(read_value<std::uint64_t>(is));
+        std::uint8_t argument_num = read_value<std::uint8_t>(is);
+        segment->frames.emplace_back(Id(), argument_num, segment->values.size());
+        for (std::uint8_t i = 0; i < argument_num; ++i)
+            segment->values.push_back(read_value<Value>(is));
+    }
+
+    // Find nodes by number
+    std::unordered_map<std::uint64_t, std::vector<std::size_t>> frames;
+    for (std::size_t n = 0; n < node_nums.size(); ++n)
+        frames[node_nums[n]].push_back(n);
+    std::size_t found_num = 0;
+    if (frame_num > 0) {
+        id::for_each_node(
+            env_.node_manager(), root_,
+            [&](const Id& id, NodeNum n, NodeNum) {
+                auto it = frames.find(n);
+                if (it != frames.end()) {
+                    for (std::size_t frame : it->second)
+                        segment->frames[frame].id = id;
+                    found_num += it->second.size();
+                }
+                return found_num == frame_num;
+            });
+    }
+    if (found_num != frame_num)
+        throw_invalid_snapshot("node not found");
+
+    // Check argument numbers, they are stored as number of evaluated ones,
+    // and that each frame is pushed for next argument of previous one
+    const NodeManager& nm = env_.node_manager();
+    if (!segment->frames.empty()
+        && !is_pushed_for(env_, root_, segment->frames[0].id))
+        throw_invalid_snapshot("first frame is not root");
+    for (std::size_t n = 0; n < segment->frames.size(); ++n) {
+        Frame& frame = segment->frames[n];
+        bool is_top = (n + 1 == segment->frames.size());
+        std::size_t evaluated = !is_top
+            ? segment->frames[n + 1].base - frame.base
+            : segment->values.size() - frame.base;
+        frame.argument_num = get_argument_num(env_, frame.id);
+        if (evaluated > frame.argument_num
+            || (!is_top && evaluated == frame.argument_num))
+            throw_invalid_snapshot("too many arguments");
+        if (!is_top) {
+            const Id& argument = id::nth_argument(nm, frame.id, evaluated);
+            if (!is_pushed_for(env_, argument, segment->frames[n + 1].id))
+                throw_invalid_snapshot("frame is not argument of previous one");
+        }
+    }
+    if (snapshot.is_finished_ && !segment->frames.empty())
+        throw_invalid_snapshot("frames left after finish");
+
+    snapshot.stack_.frame_num = segment->frames.size();
+    snapshot.stack_.segment = std::move(segment);
+    restore(snapshot);
+}
+
+
+void Exec::thaw() {
+    assert(stack_.empty() && values_.empty());
+    assert(frozen_.frame_num > 0);
+    const Segment& segment = *frozen_.segment;
+    std::size_t n = frozen_.frame_num - 1;
+    const Frame& frame = segment.frames[n];
+    std::size_t end = (n + 1 < segment.frames.size())
+        ? segment.frames[n + 1].base
+        : segment.values.size();
+    values_.assign(
+        segment.values.begin() + frame.base,
+        segment.values.begin() + end);
+    stack_.emplace_back(frame.id, frame.argument_num, 0);
+
+    // Go to parent segment when all frames are thawed
+    frozen_.frame_num = n;
+    if (frozen_.frame_num == 0) {
+        StackView parent = segment.parent;
+        frozen_ = std::move(parent);
+    }
+}
+
 void Exec::stack_clear() {
+    frozen_ = StackView();
     stack_.clear();
+    values_.clear();
 }
 
 void Exec::stack_push(const Id& id) {
     Arity argument_num = get_argument_num(env_, id);
-    stack_.emplace_back(id, argument_num);
+    stack_.emplace_back(id, argument_num, values_.size());
 }
 
 void Exec::stack_return(Value value) {
@@ -126,42 +375,71 @@ void Exec::stack_return(Value value) {
         result_ = value;
     } else {
         // set next argument to result
-        Frame& current = stack_top();
+        Frame& top = stack_top();
         assert(
-            current.arguments.size() < current.argument_num
+            values_.size() - top.base < top.argument_num
             && "Too many arguments");
-        current.arguments.push_back(value);
+        values_.push_back(value);
     }
 }
 
 void Exec::stack_pop() {
+    values_.resize(stack_top().base);
     stack_.pop_back();
 }
 
 Exec::Frame& Exec::stack_top() {
+    if (stack_.empty())
+        thaw();
     return stack_.back();
 }
 
 bool Exec::stack_empty() const {
-    return stack_.empty();
+    return stack_.empty() && frozen_.frame_num == 0;
 }
 
-Exec::Frame& Exec::stack_frame(unsigned n) {
-    return stack_[n];
-}
+std::vector<std::pair<Exec::Frame, ArgumentSpan>> Exec::frames() const {
+    // Collect frozen segments from top to bottom
+    std::vector<std::pair<Frame, ArgumentSpan>> result;
+    for (const StackView* view = &frozen_; view->frame_num > 0;
+         view = &view->segment->parent)
+    {
+        const Segment& segment = *view->segment;
+        for (std::size_t n = view->frame_num; n-- > 0;) {
+            const Frame& frame = segment.frames[n];
+            std::size_t end = (n + 1 < segment.frames.size())
+                ? segment.frames[n + 1].base
+                : segment.values.size();
+            result.emplace_back(
+                frame,
+                ArgumentSpan(
+                    segment.values.data() + frame.base,
+                    end - frame.base));
+        }
+    }
+    std::reverse(result.begin(), result.end());
 
-unsigned Exec::stack_size() const {
-    return stack_.size();
+    // Local stack
+    for (std::size_t n = 0; n < stack_.size(); ++n) {
+        std::size_t end = (n + 1 < stack_.size())
+            ? stack_[n + 1].base
+            : values_.size();
+        result.emplace_back(
+            stack_[n],
+            ArgumentSpan(values_.data() + stack_[n].base, end - stack_[n].base));
+    }
+    return result;
 }
 
 std::ostream& ExecDebug::print_backtrace(
     std::ostream& os,
     PrintFlags flags) const
 {
-    if (exec_.stack_size() > 0) {
-        for (unsigned n = 0; n < exec_.stack_size(); ++n) {
+    std::vector<std::pair<Exec::Frame, ArgumentSpan>> frames = exec_.frames();
+    if (!frames.empty()) {
+        for (unsigned n = 0; n < frames.size(); ++n) {
             os << "#" << n << " ";
-            print_frame(os, exec_.stack_frame(n), flags);
+            print_frame(os, frames[n].first, frames[n].second, flags);
             os << std::endl;
         }
     } else {
@@ -172,25 +450,25 @@ std::ostream& ExecDebug::print_backtrace(
 
 std::ostream& ExecDebug::print_frame(
     std::ostream& os,
-    Exec::Frame& frame,
+    const Exec::Frame& frame,
+    ArgumentSpan arguments,
     PrintFlags flags) const
 {
     // Print ID
     if (flags & PrintIds)
         os << frame.id << " ";
-
     // Print symbol name
     os << exec_.env_.symbols().by_id(frame.id)->name();
 
     // Print arguments
     os << " : ";
-    for (const Value& value : frame.arguments) {
+    for (const Value& value : arguments) {
         os << value << " ";
     }
 
     // Print <empty> for missing arguments
-    assert(frame.argument_num >= frame.arguments.size());
-    for (unsigned i = 0; i < frame.argument_num - frame.arguments.size(); ++i) {
+    assert(frame.argument_num >= arguments.size());
+    for (unsigned i = 0; i < frame.argument_num - arguments.size(); ++i) {
         os << "<empty> ";
     }
 
@@ -0,0 +1,268 @@
+#include <stree/frozen_tree.hpp>
+#include <cassert>
+#include <sstream>
+#include <stdexcept>
+
+namespace stree {
+
+const FrozenNode* FrozenNode::argument(Arity n) const {
+    assert(n < arity);
+    const FrozenNode* node = first();
+    for (; n > 0; --n)
+        node = node->next();
+    return node;
+}
+
+
+FrozenTree::FrozenTree(const Environment& env, const Id& root)
+    : env_(&env)
+{
+    if (!id::is_valid_subtree(env_->node_manager(), root))
+        throw std::invalid_argument("Cannot freeze invalid subtree");
+    auto nodes = std::make_shared<NodeList>();
+    freeze(*nodes, root);
+    nodes->shrink_to_fit();
+    nodes_ = nodes->data();
+    size_ = nodes->size();
+    storage_ = std::move(nodes);
+}
+
+Value FrozenTree::eval(const Params& params, DataPtr data) const {
+    EvalContext context;
+    return eval(context, params, data);
+}
+
+Value FrozenTree::eval(
+    EvalContext& context,
+    const Params& params, DataPtr data) const
+{
+    // stack may be left non-empty by exception thrown from function
+    context.stack_.clear();
+    return eval_node(context, &root(), params, data);
+}
+
+Tree FrozenTree::to_tree(Environment* env) const {
+    if (env->origin() != env_->origin())
+        throw std::invalid_argument(
+            "Cannot make tree in environment with different symbols");
+    return Tree(env, thaw(env->node_manager(), &root()));
+}
+
+bool FrozenTree::equal(const TreeBase& tree) const {
+    if (tree.env()->origin() != env_->origin())
+        return false;
+    // compare nodes in preorder
+    const NodeManager& nm = tree.env()->node_manager();
+    const FrozenNode* node = &root();
+    std::vector<Id> stack{tree.root()};
+    while (!stack.empty()) {
+        Id id = stack.back();
+        stack.pop_back();
+        if (id.empty() || id.type() != node->type || id.arity() != node->arity)
+            return false;
+        switch (node->type) {
+            case TypeConst:
+                if (id::value(nm, id) != node->value)
+                    return false;
+                break;
+            case TypePositional:
+                if (id::position(nm, id) != node->position)
+                    return false;
+                break;
+            case TypeFunction:
+                if (id::fid(nm, id) != node->fid)
+                    return false;
+                break;
+            case TypeSelect:
+                if (id::sfid(nm, id) != node->sfid)
+                    return false;
+                break;
+        }
+        for (Arity n = id.arity(); n > 0; --n)
+            stack.push_back(id::nth_argument(nm, id, n - 1));
+        ++node;
+    }
+    return true;
+}
+
+void FrozenTree::freeze(NodeList& nodes, const Id& id) {
+    const NodeManager& nm = env_->node_manager();
+    std::size_t index = nodes.size();
+    FrozenNode node{};
+    node.type = id.type();
+    node.arity = id.arity();
+    node.argument_num = get_argument_num(*env_, id);
+    switch (id.type()) {
+        case TypeConst:
+            node.value = id::value(nm, id);
+            break;
+        case TypePositional:
+            node.position = id::position(nm, id);
+            break;
+        case TypeFunction:
+            node.fid = id::fid(nm, id);
+            break;
+        case TypeSelect:
+            node.sfid = id::sfid(nm, id);
+            break;
+    }
+    nodes.push_back(node);
+    for (Arity n = 0; n < id.arity(); ++n)
+        freeze(nodes, id::nth_argument(nm, id, n));
+    nodes[index].size = nodes.size() - index;
+}
+
+Value FrozenTree::eval_node(
+    EvalContext& context,
+    const FrozenNode* node,
+    const Params& params, DataPtr data) const
+{
+    switch (node->type) {
+        case TypeConst:
+            return node->value;
+        case TypePositional:
+            assert(
+                node->position < params.size()
+                && "Invalid positional argument index");
+            return params[node->position];
+        case TypeFunction:
+        case TypeSelect: {
+            // eval arguments
+            std::vector<Value>& stack = context.stack_;
+            std::size_t base = stack.size();
+            const FrozenNode* arg = node->first();
+            for (Arity n = 0; n < node->argument_num; ++n) {
+                // NOTE: evaluate before pushing, stack may be reallocated
+                Value value = eval_node(context, arg, params, data);
+                stack.push_back(value);
+                arg = arg->next();
+            }
+            ArgumentSpan arguments(stack.data() + base, node->argument_num);
+            if (node->type == TypeFunction) {
+                Value value = context.call_function(
+                    *env_, node->fid, arguments, data);
+                stack.resize(base);
+                return value;
+            }
+            unsigned branch = context.call_select_function(
+                *env_, node->sfid, arguments, data);
+            assert(branch < node->arity && "Invalid branch selected");
+            if (branch < node->argument_num) {
+                Value value = stack[base + branch];
+                stack.resize(base);
+                return value;
+            }
+            stack.resize(base);
+            return eval_node(context, node->argument(branch), params, data);
+        }
+    }
+    assert(false);
+    return Value{};
+}
+
+Id FrozenTree::thaw(NodeManager& nm, const FrozenNode* node) const {
+    Id id = id::make(nm, node->type, node->arity);
+    switch (node->type) {
+        case TypeConst:
+            id::set_value(nm, id, node->value);
+            break;
+        case TypePositional:
+            id::set_position(nm, id, node->position);
+            break;
+        case TypeFunction:
+            id::set_fid(nm, id, node->fid);
+            break;
+        case TypeSelect:
+            id::set_sfid(nm, id, node->sfid);
+            break;
+    }
+    const FrozenNode* arg = node->first();
+    for (Arity n = 0; n < node->arity; ++n) {
+        // NOTE: make argument first, allocation may invalidate reference
+        Id arg_id = thaw(nm, arg);
+        id::nth_argument(nm, id, n) = arg_id;
+        arg = arg->next();
+    }
+    return id;
+}
+
+
+bool operator==(const FrozenTree& tree1, const FrozenTree& tree2) {
+    if (tree1.env()->origin() != tree2.env()->origin()
+        || tree1.size() != tree2.size())
+        return false;
+    for (NodeNum n = 0; n < tree1.size(); ++n) {
+        const FrozenNode& node1 = tree1.nodes()[n];
+        const FrozenNode& node2 = tree2.nodes()[n];
+        if (node1.type != node2.type || node1.arity != node2.arity)
+            return false;
+        switch (node1.type) {
+            case TypeConst:
+                if (node1.value != node2.value)
+                    return false;
+                break;
+            case TypePositional:
+                if (node1.position != node2.position)
+                    return false;
+                break;
+            case TypeFunction:
+                if (node1.fid != node2.fid)
+                    return false;
+                break;
+            case TypeSelect:
+                if (node1.sfid != node2.sfid)
+                    return false;
+                break;
+        }
+    }
+    return true;
+}
+
+bool operator!=(const FrozenTree& tree1, const FrozenTree& tree2) {
+    return !(tree1 == tree2);
+}
+
+
+template<typename S>
+static S& frozen_subtree_to_stream(
+    S& stream,
+    const FrozenNode* node,
+    const Environment& env)
+{
+    if (node->type == TypeConst) {
+        stream << node->value;
+        return stream;
+    }
+    const SymbolPtr& symbol = (node->type == TypePositional)
+        ? env.symbols().by_position(node->position)
+        : (node->type == TypeFunction)
+        ? env.symbols().by_fid(node->fid)
+        : env.symbols().by_sfid(node->sfid);
+    if (!symbol)
+        throw std::invalid_argument("Symbol not found");
+
+    if (symbol->is_callable())
+        stream << '(';
+    stream << symbol->name();
+    const FrozenNode* arg = node->first();
+    for (Arity n = 0; n < node->arity; ++n) {
+        stream << ' ';
+        frozen_subtree_to_stream(stream, arg, env);
+        arg = arg->next();
+    }
+    if (symbol->is_callable())
+        stream << ')';
+    return stream;
+}
+
+std::string to_string(const FrozenTree& tree) {
+    std::stringstream ss;
+    frozen_subtree_to_stream(ss, &tree.root(), *tree.env());
+    return ss.str();
+}
+
+} // namespace stree
+
+std::ostream& operator<<(std::ostream& os, const stree::FrozenTree& tree) {
+    return os << stree::to_string(tree);
+}
@@ -0,0 +1,189 @@
+#include <stree/level_index.hpp>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+namespace stree {
+
+void LevelIndex::clear() {
+    entries_.clear();
+    size_ = 0;
+}
+
+void LevelIndex::build(const NodeManager& nm, const Id& root) {
+    clear();
+    if (root.empty())
+        return;
+    add(nm, root, Id());
+    for (const LevelCount& level : entries_.at(root).levels)
+        size_ += level.size;
+}
+
+const Id& LevelIndex::nth(
+    const NodeManager& nm,
+    const Id& root,
+    NodeNum n,
+    IsTerminal is_terminal,
+    NodeNum& depth) const
+{
+    // Find level
+    const LevelCountList& levels = entries_.at(root).levels;
+    NodeNum level = 0;
+    for (; level < levels.size(); ++level) {
+        NodeNum num = count(levels[level], is_terminal);
+        if (n < num)
+            break;
+        n -= num;
+    }
+    if (level == levels.size())
+        throw std::range_error("Invalid node number");
+    depth = level;
+
+    // Descend to node, `n' is number of node on level
+    // below current node
+    const Id* current = &root;
+    for (NodeNum current_depth = 0; current_depth < level; ++current_depth) {
+        NodeNum child_level = level - current_depth - 1;
+        bool found = false;
+        for (Arity n_arg = 0; n_arg < current->arity(); ++n_arg) {
+            const Id& argument = id::nth_argument(nm, *current, n_arg);
+            const LevelCountList& argument_levels = entries_.at(argument).levels;
+            NodeNum num = (child_level < argument_levels.size())
+                ? count(argument_levels[child_level], is_terminal)
+                : 0;
+            if (n < num) {
+                current = &argument;
+                found = true;
+                break;
+            }
+            n -= num;
+        }
+        assert(found && "Level index is not valid");
+    }
+    assert(n == 0);
+    return *current;
+}
+
+Id LevelIndex::parent(const Id& id) const {
+    auto it = entries_.find(id);
+    return (it != entries_.end()) ? it->second.parent : Id();
+}
+
+void LevelIndex::replace(
+    const NodeManager& nm,
+    const Id& parent,
+    const Id& old_subtree,
+    const Id& new_subtree)
+{
+    auto it = entries_.find(old_subtree);
+    if (parent.empty()
+        || it == entries_.end()
+        || entries_.find(parent) == entries_.end())
+    {
+        // Root replaced or not indexed
+        clear();
+        return;
+    }
+
+    // Old subtree entries are kept, may be still used
+    // if subtree is moved within same tree
+    LevelCountList old_levels = it->second.levels;
+    add(nm, new_subtree, parent);
+    const LevelCountList& new_levels = entries_.at(new_subtree).levels;
+
+    // Update ancestors
+    std::size_t offset = 1;
+    for (Id id = parent; !id.empty(); ++offset) {
+        Entry& entry = entries_.at(id);
+        LevelCountList& levels = entry.levels;
+        if (levels.size() < offset + new_levels.size())
+            levels.resize(offset + new_levels.size(), LevelCount{0, 0});
+        for (std::size_t n = 0; n < old_levels.size(); ++n) {
+            assert(levels[offset + n].size >= old_levels[n].size);
+            levels[offset + n].size -= old_levels[n].size;
+            levels[offset + n].term_num -= old_levels[n].term_num;
+        }
+        for (std::size_t n = 0; n < new_levels.size(); ++n) {
+            levels[offset + n].size += new_levels[n].size;
+            levels[offset + n].term_num += new_levels[n].term_num;
+        }
+        while (levels.back().size == 0)
+            levels.pop_back();
+        id = entry.parent;
+    }
+    for (const LevelCount& level : old_levels)
+        size_ -= level.size;
+    for (const LevelCount& level : new_levels)
+        size_ += level.size;
+}
+
+void LevelIndex::compact(const NodeManager& nm, const Id& root) {
+    // Drop entries of removed nodes
+    if (!empty() && entries_.size() > 2 * size_ + 64)
+        build(nm, root);
+}
+
+void LevelIndex::replace_id(
+    const NodeManager& nm,
+    const Id& old_id,
+    const Id& new_id)
+{
+    auto it = entries_.find(old_id);
+    if (it == entries_.end()) {
+        clear();
+        return;
+    }
+    Entry entry = std::move(it->second);
+    entries_.erase(it);
+    for (Arity n = 0; n < new_id.arity(); ++n)
+        entries_.at(id::nth_argument(nm, new_id, n)).parent = new_id;
+    entries_[new_id] = std::move(entry);
+}
+
+void LevelIndex::add(const NodeManager& nm, const Id& id, const Id& parent) {
+    struct Frame {
+        Id id;
+        Arity next;
+    };
+
+    entries_[id].parent = parent;
+    std::vector<Frame> stack{{id, 0}};
+    while (!stack.empty()) {
+        Frame& top = stack.back();
+        if (top.next < top.id.arity()) {
+            // Add next argument
+            const Id& argument = id::nth_argument(nm, top.id, top.next++);
+            entries_[argument].parent = top.id;
+            stack.push_back({argument, 0});
+            continue;
+        }
+
+        // Arguments added, sum their counts
+        LevelCountList levels{{1, (top.id.arity() == 0) ? 1u : 0u}};
+        for (Arity n = 0; n < top.id.arity(); ++n) {
+            const Id& argument = id::nth_argument(nm, top.id, n);
+            const LevelCountList& argument_levels = entries_.at(argument).levels;
+            if (levels.size() < argument_levels.size() + 1)
+                levels.resize(argument_levels.size() + 1, LevelCount{0, 0});
+            for (std::size_t k = 0; k < argument_levels.size(); ++k) {
+                levels[k + 1].size += argument_levels[k].size;
+                levels[k + 1].term_num += argument_levels[k].term_num;
+            }
+        }
+        entries_.at(top.id).levels = std::move(levels);
+        stack.pop_back();
+    }
+}
+
+NodeNum LevelIndex::count(const LevelCount& level, IsTerminal is_terminal) {
+    switch (is_terminal) {
+        case IsTerminalYes:
+            return level.term_num;
+        case IsTerminalNo:
+            return level.size - level.term_num;
+        default:
+            return level.size;
+    }
+}
+
+} // namespace stree
@@ -0,0 +1,44 @@
+#include <stree/mapped_file.hpp>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace stree {
+
+MappedFile::MappedFile(const std::string& path)
+    : data_(nullptr),
+      size_(0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::runtime_error(
+            "Cannot open `" + path + "': " + std::strerror(errno));
+    struct stat st;
+    int error = 0;
+    if (::fstat(fd, &st) == 0) {
+        size_ = st.st_size;
+        // empty file cannot be mapped
+        if (size_ > 0) {
+            data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data_ == MAP_FAILED)
+                error = errno;
+        }
+    } else {
+        error = errno;
+    }
+    ::close(fd);
+    if (error != 0)
+        throw std::runtime_error(
+            "Cannot map `" + path + "': " + std::strerror(error));
+}
+
+MappedFile::~MappedFile() {
+    if (size_ > 0)
+        ::munmap(data_, size_);
+}
+
+} // namespace stree
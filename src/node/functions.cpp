@@ -1,6 +1,9 @@
 #include <stree/node/functions.hpp>
 #include <stree/node/impl.hpp>
 #include <stree/node/manager.hpp>
+#include <stree/node/traversal.hpp>
+#include <queue>
+#include <utility>
 
 std::ostream& operator<<(std::ostream& os, const stree::Id& id) {
     os << '(';
@@ -19,9 +22,6 @@ namespace stree { namespace id {
 
 using _NodeRefQueue = std::queue<std::reference_wrapper<Id>>;
 using _ConstNodeRefQueue = std::queue<std::reference_wrapper<const Id>>;
-using _ConstNodeRefDepthPair = std::pair<const Id&, NodeNum>;
-using _ConstNodeRefDepthPairQueue = std::queue<_ConstNodeRefDepthPair>;
-using _NodeWidthMap = std::unordered_map<Id, NodeNum>;
 
 
 #define STREE_TMP_MAKE_FUN_ARITY_CASE(_arity)                   \
@@ -107,54 +107,39 @@ Id move(Id& id) {
 }
 
 
-// TODO: use map (see subtree_width)
 NodeNum subtree_size(const NodeManager& nm, const Id& id) {
     NodeNum size = 0;
-    if (!id.empty()) {
-        ++size;
-        for (NodeNum n = 0; n < id.arity(); ++n)
-            size += subtree_size(nm, nth_argument(nm, id, n));
-    }
+    if (!id.empty())
+        preorder(nm, id, [&size](const Id& id, NodeNum) {
+            size += !id.empty();
+            return false;
+        });
     return size;
 }
 
-
-namespace {
-NodeNum _subtree_width(
-    const NodeManager& nm,
-    const Id& id,
-    _NodeWidthMap& width_map)
-{
-    // Look up in map
-    auto it = width_map.find(id);
-    if (it != width_map.end())
-        return (*it).second;
-
-    // Calc. width
+// Terminal width is 1, non-terminal width is sum of argument widths,
+// i.e. number of terminals
+NodeNum subtree_width(const NodeManager& nm, const Id& id) {
     NodeNum width = 0;
-    for (Arity n = 0; n < id.arity(); ++n)
-        width += _subtree_width(nm, nth_argument(nm, id, n), width_map);
-    width = std::max(static_cast<NodeNum>(1), width);
-
-    // Store in map
-    width_map[id] = width;
-
+    preorder(nm, id, [&width](const Id& id, NodeNum) {
+        width += (id.empty() || id.arity() == 0);
+        return false;
+    });
     return width;
 }
-} // empty namespace
-
-NodeNum subtree_width(const NodeManager& nm, const Id& id) {
-    _NodeWidthMap width_map;
-    return _subtree_width(nm, id, width_map);
-}
 
 
 void destroy_subtree(NodeManager& nm, Id& root) {
-    if (!root.empty()) {
-        for (Arity n = 0; n < root.arity(); ++n)
-            destroy_subtree(nm, nth_argument(nm, root, n));
+    // nodes are not freed one by one in arena mode
+    if (nm.is_arena()) {
         destroy(nm, root);
+        return;
     }
+    if (!root.empty())
+        postorder(nm, root, [&nm](Id& id, NodeNum) {
+            destroy(nm, id);
+            return false;
+        });
 }
 
 
@@ -165,13 +150,12 @@ bool is_valid(const NodeManager& nm, const Id& id) {
 bool is_valid_subtree(const NodeManager& nm, const Id& root) {
     if (root.empty())
         return false;
-    for (Arity n = 0; n < root.arity(); ++n)
-        if (!is_valid_subtree(nm, nth_argument(nm, root, n)))
-            return false;
-    return true;
+    // Stop on first empty node
+    return !preorder(nm, root, [](const Id& id, NodeNum) {
+        return id.empty();
+    });
 }
 
-
 #define STREE_TMP_ARGUMENT_FUN_ARITY_CASE(_arity)                       \
     else if (id.arity() == _arity) {                                    \
         return nm.get<FunctionNode<_arity>, TypeFunction>(id.index()).argument(n); \
@@ -215,33 +199,80 @@ Id& nth_argument(NodeManager& nm, Id& id, Arity n) {
 
 
 Id copy(NodeManager& nm, const Id id) {
+    return copy(nm, nm, id);
+}
+
+Id copy_subtree(NodeManager& nm, const Id root) {
+    return copy_subtree(nm, nm, root);
+}
+
+Id copy(NodeManager& nm, const NodeManager& src_nm, const Id id) {
     Id result;
     if (!id.empty()) {
         result = make(nm, id.type(), id.arity());
         switch (result.type()) {
         case TypeConst:
-            set_value(nm, result, value(nm, id));
+            set_value(nm, result, value(src_nm, id));
             break;
         case TypePositional:
-            set_position(nm, result, position(nm, id));
+            set_position(nm, result, position(src_nm, id));
             break;
         case TypeFunction:
-            set_fid(nm, result, fid(nm, id));
+            set_fid(nm, result, fid(src_nm, id));
             break;
         case TypeSelect:
-            set_sfid(nm, result, sfid(nm, id));
+            set_sfid(nm, result, sfid(src_nm, id));
             break;
         }
     }
     return result;
 }
 
-Id copy_subtree(NodeManager& nm, const Id root) {
-    Id root_copy = copy(nm, root);
-    if (!root.empty()) {
-        for (Arity n = 0; n < root.arity(); ++n) {
-            Id arg_copy = copy_subtree(nm, nth_argument(nm, root, n));
-            nth_argument(nm, root_copy, n) = arg_copy;
+Id copy_subtree(NodeManager& nm, const NodeManager& src_nm, const Id root) {
+    // Nodes are copied in preorder. Source and copy parent are stored
+    // by value: allocation may invalidate references if `nm'
+    // is same as `src_nm'.
+    struct Frame {
+        Id id;
+        Id parent_copy;
+        Arity n;
+    };
+
+    Id root_copy = copy(nm, src_nm, root);
+    if (root.empty())
+        return root_copy;
+    SmallVector<Frame, TraversalInlineDepth * 2> stack;
+    for (Arity n = root.arity(); n > 0; --n)
+        stack.push_back({nth_argument(src_nm, root, n - 1), root_copy, Arity(n - 1)});
+    while (!stack.empty()) {
+        Frame frame = stack.back();
+        stack.pop_back();
+        Id id_copy = copy(nm, src_nm, frame.id);
+        nth_argument(nm, frame.parent_copy, frame.n) = id_copy;
+        if (frame.id.empty())
+            continue;
+        for (Arity n = frame.id.arity(); n > 0; --n)
+            stack.push_back({nth_argument(src_nm, frame.id, n - 1), id_copy, Arity(n - 1)});
+    }
+    return root_copy;
+}
+
+Id copy_subtree_bfs(NodeManager& nm, const NodeManager& src_nm, const Id root) {
+    Id root_copy = copy(nm, src_nm, root);
+    // source nodes and their copies
+    std::queue<std::pair<Id, Id>> queue;
+    if (!root.empty())
+        queue.emplace(root, root_copy);
+    while (!queue.empty()) {
+        Id id = queue.front().first;
+        Id id_copy = queue.front().second;
+        queue.pop();
+        for (Arity n = 0; n < id.arity(); ++n) {
+            const Id& arg = nth_argument(src_nm, id, n);
+            Id arg_copy = copy(nm, src_nm, arg);
+            nth_argument(nm, id_copy, n) = arg_copy;
+            if (!arg.empty())
+                queue.emplace(arg, arg_copy);
         }
     }
     return root_copy;
@@ -344,27 +375,56 @@ Id& nth_node(NodeManager& nm, Id& id, NodeNum n) {
 }
 
 const Id& nth_node(const NodeManager& nm, const Id& id, NodeNum n, const NodeFilter& filter) {
+    NodeNum depth;
+    return nth_node(nm, id, n, filter, depth);
+}
+
+Id& nth_node(NodeManager& nm, Id& id, NodeNum n, const NodeFilter& filter) {
+    NodeNum depth;
+    return nth_node(nm, id, n, filter, depth);
+}
+
+const Id& nth_node(
+    const NodeManager& nm,
+    const Id& id,
+    NodeNum n,
+    const NodeFilter& filter,
+    NodeNum& depth)
+{
     _ConstNodeRefQueue queue;
     queue.emplace(id); // initialize queue with root
+    // Nodes are visited by level, count nodes left on current level
+    NodeNum current_depth = 0;
+    std::size_t level_left = 1;
+    std::size_t next_level_size = 0;
     while (!queue.empty()) {
         // next node from queue
         const Id& current = queue.front();
         queue.pop();
+        if (level_left == 0) {
+            ++current_depth;
+            level_left = next_level_size;
+            next_level_size = 0;
+        }
+        --level_left;
         bool match = filter.match(current);
         if (n == 0 && match) {
             // found N-th node
+            depth = current_depth;
             return current;
         } else if (filter.empty() && (n < queue.size() + 1 + current.arity())) {
             assert(is_valid(nm, current) && "All nodes before N-th should be valid");
             // one of current node children is N-th node
             // we can be sure only if we don't filter nodes
             assert(n > queue.size());
+            depth = current_depth + 1;
             return nth_argument(nm, current, n - 1 - queue.size());
         } else {
             assert(is_valid(nm, current) && "All nodes before N-th should be valid");
             // we don't know N-th node yet, add current node children to queue
             for (Arity i = 0; i < current.arity(); ++i)
                 queue.emplace(nth_argument(nm, current, i));
+            next_level_size += current.arity();
             // decrement counter if current node matches filter
             if (match) --n;
         }
@@ -372,42 +432,18 @@ const Id& nth_node(const NodeManager& nm, const Id& id, NodeNum n, const NodeFil
     throw std::range_error("Invalid node number");
 }
 
-Id& nth_node(NodeManager& nm, Id& id, NodeNum n, const NodeFilter& filter) {
+Id& nth_node(
+    NodeManager& nm,
+    Id& id,
+    NodeNum n,
+    const NodeFilter& filter,
+    NodeNum& depth)
+{
     return const_cast<Id&>(
         nth_node(
             const_cast<const NodeManager&>(nm),
             const_cast<const Id&>(id),
-            n, filter));
-}
-
-void for_each_node(
-    const NodeManager& nm,
-    const Id& id,
-    std::function<bool(const Id&, NodeNum, NodeNum)> callback)
-{
-    assert(is_valid_subtree(nm, id) && "Subtree must be valid");
-    // Node number
-    NodeNum current_num = 0;
-    // Init queue
-    _ConstNodeRefDepthPairQueue queue;
-    queue.emplace(_ConstNodeRefDepthPair(id, 0));
-    while (!queue.empty()) {
-        // Get current node
-        const Id& current = queue.front().first;
-        NodeNum current_depth = queue.front().second;
-        queue.pop();
-        // Callback. Return in result is true
-        if (callback(current, current_num, current_depth))
-            return;
-        // Inc. node number
-        ++current_num;
-        // Add all children to queue
-        for (Arity i = 0; i < current.arity(); ++i)
-            queue.emplace(
-                _ConstNodeRefDepthPair(
-                    nth_argument(nm, current, i),
-                    current_depth + 1));
-    }
+            n, filter, depth));
 }
 
 }} // namespace id, stree
@@ -1,10 +1,20 @@
 #include <stree/node/manager.hpp>
+#include <cassert>
+#include <stdexcept>
+#include <stree/node/functions.hpp>
+#include <stree/node/traversal.hpp>
 
 namespace stree {
 
+void NodeManager::check_not_frozen() const {
+    if (frozen_)
+        throw std::logic_error("Node manager is frozen");
+}
+
 #define STREE_TMP_MEMBER_IMPL(_Node, _type, _member)                    \
     template<>                                                          \
     Id::Index NodeManager::alloc<_Node, _type>() {                      \
+        check_not_frozen();                                             \
         return _member.alloc();                                         \
     }                                                                   \
     template<>                                                          \
@@ -17,7 +27,9 @@ namespace stree {
     }                                                                   \
     template<>                                                          \
     void NodeManager::free<_Node, _type>(Id::Index index) {             \
-        _member.free(index);                                            \
+        check_not_frozen();                                             \
+        if (!arena_)                                                    \
+            _member.free(index);                                        \
     }
 
 #define STREE_TMP_MEMBER_FUN_IMPL(_arity)                               \
@@ -35,4 +47,222 @@ STREE_FOR_EACH_SELECT_ARITY(STREE_TMP_MEMBER_SELECT_IMPL)
 #undef STREE_TMP_MEMBER_SELECT_IMPL
 #undef STREE_TMP_MEMBER_IMPL
 
+
+#define STREE_TMP_RESERVE_FUN_ARITY_CASE(_arity)    \
+    else if (arity == _arity) {                     \
+        fun ## _arity.reserve(num);                 \
+    }
+
+#define STREE_TMP_RESERVE_SELECT_ARITY_CASE(_arity) \
+    else if (arity == _arity) {                     \
+        select ## _arity.reserve(num);              \
+    }
+
+void NodeManager::reserve(Type type, Arity arity, std::size_t num) {
+    check_not_frozen();
+    switch (type) {
+    case TypeConst:
+        val.reserve(num);
+        break;
+    case TypePositional:
+        pos.reserve(num);
+        break;
+    case TypeFunction:
+        if (false) {}
+        STREE_FOR_EACH_FUN_ARITY(STREE_TMP_RESERVE_FUN_ARITY_CASE)
+        else { assert(false && "Invalid function arity"); }
+        break;
+    case TypeSelect:
+        if (false) {}
+        STREE_FOR_EACH_SELECT_ARITY(STREE_TMP_RESERVE_SELECT_ARITY_CASE)
+        else { assert(false && "Invalid select arity"); }
+        break;
+    }
+}
+
+#undef STREE_TMP_RESERVE_FUN_ARITY_CASE
+#undef STREE_TMP_RESERVE_SELECT_ARITY_CASE
+
+
+#define STREE_TMP_RELEASE(_member)              \
+    _member.release();
+
+#define STREE_TMP_RELEASE_FUN(_arity)           \
+    STREE_TMP_RELEASE(fun ## _arity)
+
+#define STREE_TMP_RELEASE_SELECT(_arity)        \
+    STREE_TMP_RELEASE(select ## _arity)
+
+void NodeManager::release() {
+    check_not_frozen();
+    STREE_TMP_RELEASE(pos)
+    STREE_TMP_RELEASE(val)
+    STREE_FOR_EACH_FUN_ARITY(STREE_TMP_RELEASE_FUN)
+    STREE_FOR_EACH_SELECT_ARITY(STREE_TMP_RELEASE_SELECT)
+}
+
+#undef STREE_TMP_RELEASE_FUN
+#undef STREE_TMP_RELEASE_SELECT
+#undef STREE_TMP_RELEASE
+
+
+#define STREE_TMP_SHRINK(_member)               \
+    _member.shrink();
+
+#define STREE_TMP_SHRINK_FUN(_arity)            \
+    STREE_TMP_SHRINK(fun ## _arity)
+
+#define STREE_TMP_SHRINK_SELECT(_arity)         \
+    STREE_TMP_SHRINK(select ## _arity)
+
+void NodeManager::compact(std::vector<Id>& roots, NodeOrder order) {
+    check_not_frozen();
+    // Copy trees to new manager, old nodes are destroyed with it
+    NodeManager compacted;
+    for (Id& root : roots) {
+        root = (order == NodeOrderBfs)
+            ? id::copy_subtree_bfs(compacted, *this, root)
+            : id::copy_subtree(compacted, *this, root);
+    }
+    swap(compacted);
+    STREE_TMP_SHRINK(pos)
+    STREE_TMP_SHRINK(val)
+    STREE_FOR_EACH_FUN_ARITY(STREE_TMP_SHRINK_FUN)
+    STREE_FOR_EACH_SELECT_ARITY(STREE_TMP_SHRINK_SELECT)
+}
+
+#undef STREE_TMP_SHRINK_FUN
+#undef STREE_TMP_SHRINK_SELECT
+#undef STREE_TMP_SHRINK
+
+
+#define STREE_TMP_SWAP(_member)                 \
+    _member.swap(other._member);
+
+#define STREE_TMP_SWAP_FUN(_arity)              \
+    STREE_TMP_SWAP(fun ## _arity)
+
+#define STREE_TMP_SWAP_SELECT(_arity)           \
+    STREE_TMP_SWAP(select ## _arity)
+
+void NodeManager::swap(NodeManager& other) {
+    check_not_frozen();
+    other.check_not_frozen();
+    STREE_TMP_SWAP(pos)
+    STREE_TMP_SWAP(val)
+    STREE_FOR_EACH_FUN_ARITY(STREE_TMP_SWAP_FUN)
+    STREE_FOR_EACH_SELECT_ARITY(STREE_TMP_SWAP_SELECT)
+}
+
+#undef STREE_TMP_SWAP_FUN
+#undef STREE_TMP_SWAP_SELECT
+#undef STREE_TMP_SWAP
+
+
+// Merging
+
+#define STREE_TMP_OFFSET_DECL(_member)          \
+    Id::Index _member;
+
+#define STREE_TMP_OFFSET_FUN_DECL(_arity)       \
+    STREE_TMP_OFFSET_DECL(fun ## _arity)
+
+#define STREE_TMP_OFFSET_SELECT_DECL(_arity)    \
+    STREE_TMP_OFFSET_DECL(select ## _arity)
+
+// Index offsets of moved nodes, one for each pool
+struct NodeManager::MergeOffsets {
+    STREE_TMP_OFFSET_DECL(pos)
+    STREE_TMP_OFFSET_DECL(val)
+    STREE_FOR_EACH_FUN_ARITY(STREE_TMP_OFFSET_FUN_DECL)
+    STREE_FOR_EACH_SELECT_ARITY(STREE_TMP_OFFSET_SELECT_DECL)
+};
+
+#undef STREE_TMP_OFFSET_FUN_DECL
+#undef STREE_TMP_OFFSET_SELECT_DECL
+#undef STREE_TMP_OFFSET_DECL
+
+
+#define STREE_TMP_MERGE(_member)                            \
+    offsets._member = _member.merge(other._member);
+
+#define STREE_TMP_MERGE_FUN(_arity)             \
+    STREE_TMP_MERGE(fun ## _arity)
+
+#define STREE_TMP_MERGE_SELECT(_arity)          \
+    STREE_TMP_MERGE(select ## _arity)
+
+void NodeManager::merge(NodeManager& other, std::vector<Id>& roots) {
+    check_not_frozen();
+    other.check_not_frozen();
+    if (&other == this)
+        return;
+
+    MergeOffsets offsets;
+    STREE_TMP_MERGE(pos)
+    STREE_TMP_MERGE(val)
+    STREE_FOR_EACH_FUN_ARITY(STREE_TMP_MERGE_FUN)
+    STREE_FOR_EACH_SELECT_ARITY(STREE_TMP_MERGE_SELECT)
+
+    if (!NodePool<ConstNode>::MergeKeepsIndices) {
+        for (Id& root : roots)
+            update_merged_subtree(offsets, root);
+    }
+}
+
+#undef STREE_TMP_MERGE_FUN
+#undef STREE_TMP_MERGE_SELECT
+#undef STREE_TMP_MERGE
+
+
+#define STREE_TMP_MERGED_INDEX(_Node, _member)                          \
+    NodePool<_Node>::merged_index(id.index(), offsets._member)
+
+#define STREE_TMP_MERGED_FUN_ARITY_CASE(_arity)                         \
+    else if (id.arity() == _arity) {                                    \
+        index = STREE_TMP_MERGED_INDEX(FunctionNode<_arity>, fun ## _arity); \
+    }
+
+#define STREE_TMP_MERGED_SELECT_ARITY_CASE(_arity)                      \
+    else if (id.arity() == _arity) {                                    \
+        index = STREE_TMP_MERGED_INDEX(SelectNode<_arity>, select ## _arity); \
+    }
+
+Id NodeManager::merged_id(const MergeOffsets& offsets, const Id& id) const {
+    if (id.empty())
+        return id;
+    Id::Index index = Id::NoIndex;
+    switch (id.type()) {
+        case TypeConst:
+            index = STREE_TMP_MERGED_INDEX(ConstNode, val);
+            break;
+        case TypePositional:
+            index = STREE_TMP_MERGED_INDEX(PositionalNode, pos);
+            break;
+        case TypeFunction:
+            if (false) {}
+            STREE_FOR_EACH_FUN_ARITY(STREE_TMP_MERGED_FUN_ARITY_CASE)
+            else { assert(false && "Invalid function arity"); }
+            break;
+        case TypeSelect:
+            if (false) {}
+            STREE_FOR_EACH_SELECT_ARITY(STREE_TMP_MERGED_SELECT_ARITY_CASE)
+            else { assert(false && "Invalid select arity"); }
+            break;
+    }
+    return Id(id.type(), id.arity(), index);
+}
+
+#undef STREE_TMP_MERGED_FUN_ARITY_CASE
+#undef STREE_TMP_MERGED_SELECT_ARITY_CASE
+#undef STREE_TMP_MERGED_INDEX
+
+void NodeManager::update_merged_subtree(const MergeOffsets& offsets, Id& root) {
+    // Node is updated before its arguments are visited
+    id::preorder(*this, root, [this, &offsets](Id& id, NodeNum) {
+        id = merged_id(offsets, id);
+        return false;
+    });
+}
+
 } // namespace stree
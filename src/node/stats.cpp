@@ -24,7 +24,8 @@ NodeManagerStats::NodeManagerStats() {
 
 #define STREE_TMP_GET_ITEM_STATS(_nm_member)                    \
     item.pool_size = nm._nm_member.nodes_.size();               \
-    item.buffer_size = nm._nm_member.buffer_.size();
+    item.buffer_size = nm._nm_member.free_num()                 \
+        + nm._nm_member.retired_num();
 
 #define STREE_TMP_GET_FUN_ITEM_STATS(_arity)        \
     else if (item.arity == _arity) {                \
@@ -0,0 +1,152 @@
+#include <stree/node_index.hpp>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <stree/environment.hpp>
+
+namespace stree {
+
+void NodeIndex::build(TreeBase& tree) {
+    invalidate();
+    tree_ = &tree;
+    if (tree.root().empty())
+        return;
+
+    // Entry list is used as BFS queue
+    NodeManager& nm = tree.env()->node_manager();
+    entries_.push_back({&tree.root(), 0, tree.root().arity(), 1});
+    for (NodeNum n = 0; n < entries_.size(); ++n) {
+        Id& id = *entries_[n].id;
+        NodeNum depth = entries_[n].depth;
+        Arity arity = entries_[n].arity;
+        if (by_arity_.size() <= arity)
+            by_arity_.resize(arity + 1);
+        by_arity_[arity].push_back(n);
+        if (arity > 0)
+            nonterms_.push_back(n);
+        for (Arity i = 0; i < arity; ++i) {
+            Id& argument = id::nth_argument(nm, id, i);
+            entries_.push_back({&argument, depth + 1, argument.arity(), 1});
+        }
+    }
+
+    // Subtree sizes, arguments of each node are adjacent
+    // and follow arguments of previous nodes
+    NodeNum argument = entries_.size();
+    for (NodeNum n = entries_.size(); n-- > 0;) {
+        NodeIndexEntry& entry = entries_[n];
+        for (Arity i = 0; i < entry.arity; ++i)
+            entry.size += entries_[--argument].size;
+    }
+    assert(argument == 1);
+}
+
+void NodeIndex::invalidate() {
+    tree_ = nullptr;
+    entries_.clear();
+    nonterms_.clear();
+    by_arity_.clear();
+    by_arities_.clear();
+}
+
+NodeNum NodeIndex::count(const NodeFilter& filter) const {
+    const NumList* list = nums(filter);
+    return list ? list->size() : size();
+}
+
+const NodeIndexEntry& NodeIndex::nth(NodeNum n) const {
+    return entry(nullptr, n);
+}
+
+const NodeIndexEntry& NodeIndex::nth_terminal(NodeNum n) const {
+    return entry(by_arity_.empty() ? &empty_ : &by_arity_[0], n);
+}
+
+const NodeIndexEntry& NodeIndex::nth_nonterminal(NodeNum n) const {
+    return entry(&nonterms_, n);
+}
+
+const NodeIndexEntry& NodeIndex::nth(
+    NodeNum n,
+    const NodeFilter& filter) const
+{
+    return entry(nums(filter), n);
+}
+
+Subtree NodeIndex::sub(NodeNum n) {
+    return subtree(nth(n));
+}
+
+Subtree NodeIndex::sub(NodeNum n, const NodeFilter& filter) {
+    return subtree(nth(n, filter));
+}
+
+Subtree NodeIndex::term(NodeNum n) {
+    return subtree(nth_terminal(n));
+}
+
+Subtree NodeIndex::nonterm(NodeNum n) {
+    return subtree(nth_nonterminal(n));
+}
+
+const NodeIndex::NumList* NodeIndex::nums(const NodeFilter& filter) const {
+    if (filter.arity.empty()) {
+        switch (filter.is_terminal) {
+            case IsTerminalYes:
+                return by_arity_.empty() ? &empty_ : &by_arity_[0];
+            case IsTerminalNo:
+                return &nonterms_;
+            default:
+                return nullptr;
+        }
+    }
+
+    // Matching arities
+    std::vector<Arity> arities;
+    for (std::size_t arity = 0; arity < by_arity_.size(); ++arity) {
+        if (by_arity_[arity].empty())
+            continue;
+        bool is_terminal = (arity == 0);
+        if (filter.arity.has(arity)
+            && (filter.is_terminal == IsTerminalAny
+                || (filter.is_terminal == IsTerminalYes) == is_terminal))
+        {
+            arities.push_back(arity);
+        }
+    }
+    if (arities.empty())
+        return &empty_;
+    if (arities.size() == 1)
+        return &by_arity_[arities[0]];
+
+    // Merge lists for several arities
+    auto it = by_arities_.find(arities);
+    if (it == by_arities_.end()) {
+        NumList list;
+        for (Arity arity : arities)
+            list.insert(
+                list.end(),
+                by_arity_[arity].begin(), by_arity_[arity].end());
+        std::sort(list.begin(), list.end());
+        it = by_arities_.emplace(arities, std::move(list)).first;
+    }
+    return &it->second;
+}
+
+const NodeIndexEntry& NodeIndex::entry(const NumList* nums, NodeNum n) const {
+    assert(is_valid() && "Node index is not valid");
+    if (!nums) {
+        if (n >= entries_.size())
+            throw std::range_error("Invalid node number");
+        return entries_[n];
+    }
+    if (n >= nums->size())
+        throw std::range_error("Invalid node number");
+    return entries_[(*nums)[n]];
+}
+
+Subtree NodeIndex::subtree(const NodeIndexEntry& entry) {
+    return Subtree(tree_->env(), tree_, *entry.id, entry.depth);
+}
+
+} // namespace stree
@@ -0,0 +1,131 @@
+#include <stree/parallel_parser.hpp>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <stree/bulk_parser.hpp>
+#include <stree/mapped_file.hpp>
+
+namespace stree {
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Move chunk error position to whole input position
+ParserError global_error(
+    const ParserError& error,
+    const char* data,
+    std::size_t chunk_pos)
+{
+    std::size_t line_num = 0;
+    std::size_t line_start = 0;
+    for (std::size_t n = 0; n < chunk_pos; ++n) {
+        if (data[n] == '\n') {
+            ++line_num;
+            line_start = n + 1;
+        }
+    }
+    std::size_t char_num = error.char_num();
+    if (error.line_num() == 1)
+        char_num += chunk_pos - line_start;
+    return ParserError(
+        error.message(),
+        error.line_num() + line_num,
+        char_num);
+}
+
+} // namespace
+
+
+ParallelParser::ParallelParser(Scheduler& scheduler, std::size_t chunk_size)
+    : scheduler_(scheduler),
+      chunk_size_(chunk_size)
+{
+    if (chunk_size_ == 0)
+        throw std::invalid_argument("Chunk size cannot be zero");
+}
+
+std::vector<Tree> ParallelParser::parse(
+    Environment& env,
+    const char* data,
+    std::size_t size)
+{
+    std::vector<std::size_t> starts = split(data, size);
+    std::size_t chunk_num = starts.size();
+    starts.push_back(size);
+
+    std::vector<std::unique_ptr<Environment>> shards;
+    shards.reserve(chunk_num);
+    for (std::size_t n = 0; n < chunk_num; ++n)
+        shards.push_back(env.make_shard());
+
+    std::vector<std::vector<Tree>> chunk_trees(chunk_num);
+    std::vector<std::unique_ptr<ParserError>> errors(chunk_num);
+    scheduler_.run(
+        chunk_num,
+        [&](std::size_t chunk, unsigned) {
+            try {
+                BulkParser parser(shards[chunk].get());
+                chunk_trees[chunk] = parser.make_trees(
+                    parser.parse(
+                        data + starts[chunk],
+                        starts[chunk + 1] - starts[chunk]));
+            } catch (const ParserError& e) {
+                errors[chunk].reset(new ParserError(e));
+            }
+        });
+
+    for (std::size_t n = 0; n < chunk_num; ++n) {
+        if (errors[n])
+            throw global_error(*errors[n], data, starts[n]);
+    }
+
+    std::size_t tree_num = 0;
+    for (const std::vector<Tree>& trees : chunk_trees)
+        tree_num += trees.size();
+    std::vector<Tree> result;
+    result.reserve(tree_num);
+    for (std::size_t n = 0; n < chunk_num; ++n) {
+        std::vector<Tree> trees = env.merge(
+            *shards[n],
+            std::move(chunk_trees[n]));
+        for (Tree& tree : trees)
+            result.push_back(std::move(tree));
+    }
+    return result;
+}
+
+std::vector<Tree> ParallelParser::parse_file(
+    Environment& env,
+    const std::string& path)
+{
+    MappedFile file(path);
+    return parse(env, file.data(), file.size());
+}
+
+std::vector<std::size_t> ParallelParser::split(
+    const char* data,
+    std::size_t size) const
+{
+    std::vector<std::size_t> starts{0};
+    std::size_t depth = 0;
+    std::size_t next = chunk_size_;
+    for (std::size_t pos = 0; pos < size; ++pos) {
+        char c = data[pos];
+        if (c == '(') {
+            ++depth;
+        } else if (c == ')') {
+            // unmatched paren is reported by chunk parser
+            if (depth > 0)
+                --depth;
+        } else if (depth == 0 && pos >= next && is_space(c)) {
+            starts.push_back(pos);
+            next = pos + chunk_size_;
+        }
+    }
+    return starts;
+}
+
+} // namespace stree
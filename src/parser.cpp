@@ -26,7 +26,11 @@ static bool is_dot(const char c);
 
 namespace stree {
 
-ParserError::ParserError(const Parser& parser) {
+ParserError::ParserError(const Parser& parser)
+    : message_(parser.error_message()),
+      line_num_(parser.line_num()),
+      char_num_(parser.char_num())
+{
     what_ = std::string("")
         + "Parser state: " + parser.state_string() + "\n"
         + "Parser error: " + parser.error_message() + "\n"
@@ -34,6 +38,20 @@ ParserError::ParserError(const Parser& parser) {
         + " char "  + std::to_string(parser.char_num());
 }
 
+ParserError::ParserError(
+    const std::string& message,
+    std::size_t line_num,
+    std::size_t char_num)
+    : message_(message),
+      line_num_(line_num),
+      char_num_(char_num)
+{
+    what_ = std::string("")
+        + "Parser error: " + message + "\n"
+        + "Position: line " + std::to_string(line_num)
+        + " char "  + std::to_string(char_num);
+}
+
 
 Parser::Parser(Environment* env) : env_(env)
 {
@@ -172,7 +190,11 @@ std::string Parser::state_string() const {
 }
 
 std::string Parser::error_message() const {
-    switch (error_) {
+    return error_message(error_);
+}
+
+std::string Parser::error_message(Error error) {
+    switch (error) {
         case ErrorOk:
             return "Ok";
         case ErrorEmpty:
@@ -383,7 +405,7 @@ void Parser::ident(const char c) {
 }
 
 void Parser::complete_variable() {
-    auto symbol = env_->symbols().by_name(buffer_);
+    const SymbolPtr& symbol = env_->symbols().find(buffer_);
     buffer_.clear();
     if (!symbol) {
         set_error(ErrorSymbolNotFound);
@@ -395,7 +417,7 @@ void Parser::complete_variable() {
 }
 
 void Parser::complete_callable_symbol() {
-    auto symbol = env_->symbols().by_name(buffer_);
+    const SymbolPtr& symbol = env_->symbols().find(buffer_);
     buffer_.clear();
     if (!symbol) {
         set_error(ErrorSymbolNotFound);
@@ -0,0 +1,88 @@
+#include <stree/population_eval.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+namespace stree {
+
+namespace {
+
+// Freeze node manager, restore previous state on exit
+class FreezeGuard {
+public:
+    FreezeGuard(NodeManager& nm)
+        : nm_(nm),
+          was_frozen_(nm.is_frozen())
+    {
+        nm_.freeze();
+    }
+
+    ~FreezeGuard() {
+        if (!was_frozen_)
+            nm_.unfreeze();
+    }
+
+private:
+    NodeManager& nm_;
+    bool was_frozen_;
+};
+
+} // namespace
+
+
+PopulationEval::PopulationEval(Scheduler& scheduler, std::size_t block_size)
+    : scheduler_(scheduler),
+      block_size_(block_size)
+{
+    if (block_size_ == 0)
+        throw std::invalid_argument("Block size cannot be zero");
+    batch_evals_.reserve(scheduler_.worker_num());
+    for (unsigned n = 0; n < scheduler_.worker_num(); ++n)
+        batch_evals_.emplace_back(block_size_);
+}
+
+void PopulationEval::eval(
+    Environment& env,
+    const std::vector<Id>& roots,
+    const ParamMatrix& params,
+    Value* out,
+    DataPtr data)
+{
+    std::size_t row_num = params.row_num();
+    std::size_t block_num = (row_num + block_size_ - 1) / block_size_;
+    FreezeGuard guard(env.node_manager());
+    scheduler_.run(
+        roots.size() * block_num,
+        [&](std::size_t task, unsigned worker) {
+            std::size_t tree = task / block_num;
+            std::size_t first_row = (task % block_num) * block_size_;
+            batch_evals_[worker].eval(
+                env,
+                roots[tree],
+                params,
+                first_row,
+                std::min(block_size_, row_num - first_row),
+                out + tree * row_num + first_row,
+                data);
+        });
+}
+
+void PopulationEval::eval(
+    const std::vector<Tree>& trees,
+    const ParamMatrix& params,
+    Value* out,
+    DataPtr data)
+{
+    if (trees.empty())
+        return;
+    Environment* env = const_cast<Environment*>(trees.front().env());
+    std::vector<Id> roots;
+    roots.reserve(trees.size());
+    for (const Tree& tree : trees) {
+        if (tree.env() != env)
+            throw std::invalid_argument("Trees belong to different environments");
+        roots.push_back(tree.root());
+    }
+    eval(*env, roots, params, out, data);
+}
+
+} // namespace stree
@@ -0,0 +1,329 @@
+#include <stree/population_file.hpp>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <stree/mapped_file.hpp>
+
+namespace stree {
+
+namespace {
+
+const char Magic[8] = {'S', 'T', 'R', 'E', 'E', 'P', 'O', 'P'};
+const std::uint32_t ByteOrder = 0x01020304;
+const std::size_t Alignment = 8;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t value_size;
+    std::uint32_t node_size;
+    std::uint64_t symbol_num;
+    std::uint64_t tree_num;
+    std::uint64_t node_num;
+    // section offsets
+    std::uint64_t symbol_offset;
+    std::uint64_t tree_offset;
+    std::uint64_t node_offset;
+};
+
+// Followed by name
+struct SymbolRecord {
+    std::uint8_t type;
+    std::uint8_t arity;
+    std::uint8_t index;
+    std::uint8_t sf_arity;
+    std::uint32_t name_size;
+};
+
+static_assert(alignof(FrozenNode) <= Alignment, "Node alignment is too large");
+
+std::size_t aligned(std::size_t size) {
+    return (size + Alignment - 1) / Alignment * Alignment;
+}
+
+void write_padding(std::ostream& os, std::size_t size) {
+    static const char zeros[Alignment] = {};
+    os.write(zeros, aligned(size) - size);
+}
+
+std::uint8_t symbol_index(const Symbol& symbol) {
+    switch (symbol.type()) {
+        case TypePositional:
+            return symbol.position();
+        case TypeFunction:
+            return symbol.fid();
+        case TypeSelect:
+            return symbol.sfid();
+        default:
+            assert(false);
+    }
+    return 0;
+}
+
+[[noreturn]] void throw_invalid_file(const std::string& message) {
+    throw std::runtime_error(
+        std::string("Invalid population file: ") + message);
+}
+
+} // anonymous namespace
+
+
+void write_population(
+    std::ostream& os,
+    const Environment& env,
+    const std::vector<FrozenTree>& trees)
+{
+    const SymbolTable& symbols = env.symbols();
+
+    // Symbol table size
+    std::size_t symbol_num = 0;
+    std::size_t symbols_size = 0;
+    for (std::size_t n = 0; n < symbols.size(); ++n) {
+        if (symbols[n]->type() == TypeConst)
+            continue;
+        ++symbol_num;
+        symbols_size += aligned(sizeof(SymbolRecord) + symbols[n]->name().size());
+    }
+    // Tree table
+    std::vector<std::uint64_t> offsets{0};
+    offsets.reserve(trees.size() + 1);
+    for (const FrozenTree& tree : trees) {
+        if (tree.env()->origin() != env.origin())
+            throw std::invalid_argument(
+                "Tree does not belong to environment");
+        offsets.push_back(offsets.back() + tree.size());
+    }
+    std::size_t offsets_size = aligned(offsets.size() * sizeof(std::uint64_t));
+
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = PopulationFileVersion;
+    header.byte_order = ByteOrder;
+    header.value_size = sizeof(Value);
+    header.node_size = sizeof(FrozenNode);
+    header.symbol_num = symbol_num;
+    header.tree_num = trees.size();
+    header.node_num = offsets.back();
+    header.symbol_offset = aligned(sizeof(Header));
+    header.tree_offset = header.symbol_offset + symbols_size;
+    header.node_offset = header.tree_offset + offsets_size;
+
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_padding(os, sizeof(header));
+    for (std::size_t n = 0; n < symbols.size(); ++n) {
+        const Symbol& symbol = *symbols[n];
+        if (symbol.type() == TypeConst)
+            continue;
+        SymbolRecord record{};
+        record.type = symbol.type();
+        record.arity = symbol.arity();
+        record.index = symbol_index(symbol);
+        record.sf_arity = (symbol.type() == TypeSelect) ? symbol.sf_arity() : 0;
+        record.name_size = symbol.name().size();
+        os.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        os.write(symbol.name().data(), symbol.name().size());
+        write_padding(os, sizeof(record) + symbol.name().size());
+    }
+    os.write(
+        reinterpret_cast<const char*>(offsets.data()),
+        offsets.size() * sizeof(std::uint64_t));
+    write_padding(os, offsets.size() * sizeof(std::uint64_t));
+    for (const FrozenTree& tree : trees)
+        os.write(
+            reinterpret_cast<const char*>(tree.nodes()),
+            tree.size() * sizeof(FrozenNode));
+    if (!os)
+        throw std::runtime_error("Failed to write population");
+}
+
+void write_population(
+    std::ostream& os,
+    const Environment& env,
+    const std::vector<Tree>& trees)
+{
+    std::vector<FrozenTree> frozen;
+    frozen.reserve(trees.size());
+    for (const Tree& tree : trees)
+        frozen.emplace_back(tree);
+    write_population(os, env, frozen);
+}
+
+void save_population(
+    const std::string& path,
+    const Environment& env,
+    const std::vector<FrozenTree>& trees)
+{
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs)
+        throw std::runtime_error("Cannot open `" + path + "' for writing");
+    write_population(ofs, env, trees);
+}
+
+void save_population(
+    const std::string& path,
+    const Environment& env,
+    const std::vector<Tree>& trees)
+{
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs)
+        throw std::runtime_error("Cannot open `" + path + "' for writing");
+    write_population(ofs, env, trees);
+}
+
+
+// MappedPopulation
+
+MappedPopulation::MappedPopulation(
+    const Environment& env,
+    const std::string& path)
+    : env_(&env),
+      tree_num_(0),
+      node_num_(0),
+      offsets_(nullptr),
+      nodes_(nullptr),
+      zero_copy_(true)
+{
+    auto mapping = std::make_shared<const MappedFile>(path);
+    const char* data = mapping->data();
+    std::size_t size = mapping->size();
+    mapping_ = mapping;
+
+    // Check header
+    if (size < sizeof(Header))
+        throw_invalid_file("file is too small");
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+        throw_invalid_file("wrong magic number");
+    if (header.version != PopulationFileVersion)
+        throw_invalid_file("unsupported version");
+    if (header.byte_order != ByteOrder)
+        throw_invalid_file("wrong byte order");
+    if (header.value_size != sizeof(Value)
+        || header.node_size != sizeof(FrozenNode))
+        throw_invalid_file("value or node size does not match");
+
+    // Check sections
+    tree_num_ = header.tree_num;
+    node_num_ = header.node_num;
+    if (header.symbol_offset < sizeof(Header)
+        || header.symbol_offset > header.tree_offset
+        || header.tree_offset > header.node_offset
+        || header.node_offset > size
+        || header.node_offset % Alignment != 0
+        || header.tree_offset % Alignment != 0
+        || header.symbol_offset % Alignment != 0
+        || tree_num_ >= (header.node_offset - header.tree_offset)
+            / sizeof(std::uint64_t)
+        || (size - header.node_offset) / sizeof(FrozenNode) < node_num_)
+        throw_invalid_file("wrong section size");
+    offsets_ = reinterpret_cast<const std::uint64_t*>(data + header.tree_offset);
+    nodes_ = reinterpret_cast<const FrozenNode*>(data + header.node_offset);
+    storage_ = mapping_;
+    if (offsets_[0] != 0 || offsets_[tree_num_] != node_num_)
+        throw_invalid_file("wrong tree table");
+    for (std::size_t n = 0; n < tree_num_; ++n) {
+        if (offsets_[n] >= offsets_[n + 1]
+            || nodes_[offsets_[n]].size != offsets_[n + 1] - offsets_[n])
+            throw_invalid_file("wrong tree size");
+    }
+
+    read_symbols(
+        data + header.symbol_offset,
+        header.tree_offset - header.symbol_offset,
+        header.symbol_num);
+    if (!zero_copy_)
+        remap();
+}
+
+FrozenTree MappedPopulation::operator[](std::size_t n) const {
+    if (n >= tree_num_)
+        throw std::out_of_range("Tree index is out of range");
+    return FrozenTree(
+        env_,
+        storage_,
+        nodes_ + offsets_[n],
+        offsets_[n + 1] - offsets_[n]);
+}
+
+void MappedPopulation::read_symbols(
+    const char* data,
+    std::size_t size,
+    std::size_t symbol_num)
+{
+    std::size_t offset = 0;
+    for (std::size_t n = 0; n < symbol_num; ++n) {
+        if (offset > size || size - offset < sizeof(SymbolRecord))
+            throw_invalid_file("wrong symbol table");
+        SymbolRecord record;
+        std::memcpy(&record, data + offset, sizeof(record));
+        if (size - offset - sizeof(record) < record.name_size)
+            throw_invalid_file("wrong symbol table");
+        std::string name(data + offset + sizeof(record), record.name_size);
+        offset += aligned(sizeof(record) + record.name_size);
+
+        const SymbolPtr& symbol = env_->symbols().find(name);
+        if (!symbol || symbol->type() != record.type
+            || symbol->arity() != record.arity
+            || (symbol->type() == TypeSelect
+                && symbol->sf_arity() != record.sf_arity))
+            throw std::invalid_argument(
+                "Symbol `" + name + "' not found or has different arity");
+
+        std::uint8_t index = symbol_index(*symbol);
+        zero_copy_ = zero_copy_ && (index == record.index);
+        switch (symbol->type()) {
+            case TypePositional:
+                if (positions_.size() <= record.index)
+                    positions_.resize(record.index + 1);
+                positions_[record.index] = index;
+                break;
+            case TypeFunction:
+                if (fids_.size() <= record.index)
+                    fids_.resize(record.index + 1);
+                fids_[record.index] = index;
+                break;
+            case TypeSelect:
+                if (sfids_.size() <= record.index)
+                    sfids_.resize(record.index + 1);
+                sfids_[record.index] = index;
+                break;
+            default:
+                throw_invalid_file("wrong symbol type");
+        }
+    }
+}
+
+void MappedPopulation::remap() {
+    auto nodes = std::make_shared<std::vector<FrozenNode>>(
+        nodes_, nodes_ + node_num_);
+    for (FrozenNode& node : *nodes) {
+        switch (node.type) {
+            case TypeConst:
+                break;
+            case TypePositional:
+                if (node.position >= positions_.size())
+                    throw_invalid_file("wrong position");
+                node.position = positions_[node.position];
+                break;
+            case TypeFunction:
+                if (node.fid >= fids_.size())
+                    throw_invalid_file("wrong function index");
+                node.fid = fids_[node.fid];
+                break;
+            case TypeSelect:
+                if (node.sfid >= sfids_.size())
+                    throw_invalid_file("wrong select function index");
+                node.sfid = sfids_[node.sfid];
+                break;
+            default:
+                throw_invalid_file("wrong node type");
+        }
+    }
+    nodes_ = nodes->data();
+    storage_ = std::move(nodes);
+}
+
+} // namespace stree
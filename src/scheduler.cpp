@@ -0,0 +1,136 @@
+#include <stree/scheduler.hpp>
+#include <algorithm>
+#include <cassert>
+
+namespace stree {
+
+Scheduler::Scheduler(unsigned worker_num)
+    : task_(nullptr),
+      generation_(0),
+      running_(0),
+      stop_(false),
+      cancelled_(false)
+{
+    if (worker_num == 0)
+        worker_num = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned n = 0; n < worker_num; ++n)
+        queues_.emplace_back(new Queue());
+    // worker 0 is calling thread
+    for (unsigned n = 1; n < worker_num; ++n)
+        threads_.emplace_back(&Scheduler::thread_main, this, n);
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (std::thread& thread : threads_)
+        thread.join();
+}
+
+void Scheduler::run(std::size_t task_num, const Task& task) {
+    if (task_num == 0)
+        return;
+
+    // Distribute tasks
+    unsigned worker_num = queues_.size();
+    for (unsigned n = 0; n < worker_num; ++n) {
+        std::size_t first = task_num * n / worker_num;
+        std::size_t last = task_num * (n + 1) / worker_num;
+        Queue& queue = *queues_[n];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        assert(queue.tasks.empty());
+        for (std::size_t t = first; t < last; ++t)
+            queue.tasks.push_back(t);
+    }
+
+    // Start threads
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        running_ = threads_.size();
+        cancelled_ = false;
+        exception_ = nullptr;
+        ++generation_;
+    }
+    start_cv_.notify_all();
+
+    work(0);
+
+    // Wait for threads
+    std::exception_ptr exception;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]() { return running_ == 0; });
+        task_ = nullptr;
+        exception = exception_;
+        exception_ = nullptr;
+    }
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+void Scheduler::thread_main(unsigned worker) {
+    unsigned long generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [this, generation]() {
+                return stop_ || generation_ != generation;
+            });
+            if (stop_)
+                return;
+            generation = generation_;
+        }
+        work(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--running_ == 0)
+                done_cv_.notify_one();
+        }
+    }
+}
+
+void Scheduler::work(unsigned worker) {
+    std::size_t task;
+    while (pop(worker, task) || steal(worker, task)) {
+        if (cancelled_)
+            continue; // drain queues
+        try {
+            (*task_)(task, worker);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!exception_)
+                exception_ = std::current_exception();
+            cancelled_ = true;
+        }
+    }
+}
+
+bool Scheduler::pop(unsigned worker, std::size_t& task) {
+    Queue& queue = *queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool Scheduler::steal(unsigned worker, std::size_t& task) {
+    unsigned worker_num = queues_.size();
+    for (unsigned n = 1; n < worker_num; ++n) {
+        Queue& queue = *queues_[(worker + n) % worker_num];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace stree
@@ -4,6 +4,7 @@
 #include <stdexcept>
 #include <utility>
 #include <stree/environment.hpp>
+#include <stree/eval.hpp>
 
 
 namespace stree {
@@ -18,22 +19,48 @@ bool TreeDescription::is_empty() const {
     return (size == NoNodeNum)
         || (depth == NoNodeNum)
         || (term_num == NoNodeNum)
-        || (nonterm_num == NoNodeNum);
+        || (nonterm_num == NoNodeNum)
+        || (width == NoNodeNum);
 }
 
 void TreeDescription::set_null() {
-    size = depth = term_num = nonterm_num = NoNodeNum;
+    size = depth = term_num = nonterm_num = width = NoNodeNum;
 }
 
 void TreeDescription::set_zero() {
-    size = depth = term_num = nonterm_num = 0;
+    size = depth = term_num = nonterm_num = width = 0;
 }
 
-TreeBase::TreeBase(Environment* env, TreeBase* parent)
-    : env_(env), parent_(parent)
+// TreeCostBound class
+
+TreeCostBound::TreeCostBound() {
+    set_null();
+}
+
+bool TreeCostBound::is_empty() const {
+    return select_num == NoNodeNum;
+}
+
+void TreeCostBound::set_null() {
+    min = max = 0;
+    select_num = NoNodeNum;
+}
+
+void TreeCostBound::set_zero() {
+    min = max = 0;
+    select_num = 0;
+}
+
+
+// TreeBase class
+
+TreeBase::TreeBase(Environment* env, TreeBase* parent, NodeNum depth)
+    : env_(env), parent_(parent), depth_(depth), is_indexed_(false)
 {
     assert(env_ && "Tree environment cannot be empty");
-    reset_cache();
+    // NOTE: parent cache is still valid
+    reset_description();
+    reset_cost_bound();
 }
 
 bool TreeBase::is_valid() const {
@@ -48,6 +75,7 @@ void TreeBase::set(const SymbolPtr& symbol) {
     // TODO: do not replace if type matches
     // Make replacement Id
     Id id = env_->make_id(symbol);
+    Id old_id = root();
     if (!root().empty()) {
         // Copy (shallow) argument Ids
         for (Arity n = 0; n < root().arity(); ++n)
@@ -58,6 +86,12 @@ void TreeBase::set(const SymbolPtr& symbol) {
     }
     // Replace root
     root() = id;
+    for (TreeBase* tree = this; tree; tree = tree->parent_) {
+        // Symbol cost may be different
+        tree->reset_cost_bound();
+        if (!tree->index_.empty())
+            tree->index_.replace_id(env_->node_manager(), old_id, id);
+    }
 }
 
 void TreeBase::set(const std::string& name) {
@@ -79,15 +113,23 @@ Subtree TreeBase::sub(NodeNum n) {
 }
 
 const Subtree TreeBase::sub(NodeNum n, const NodeFilter& filter) const {
+    const NodeManager& nm = env_->node_manager();
+    NodeNum depth;
+    const Id& id = (is_indexed_ && filter.arity.empty())
+        ? index().nth(nm, root(), n, filter.is_terminal, depth)
+        : id::nth_node(nm, root(), n, filter, depth);
     return Subtree(
-        env_,
-        const_cast<TreeBase*>(this),
-        const_cast<Id&>(id::nth_node(env_->node_manager(), root(), n, filter)));
+        env_, const_cast<TreeBase*>(this), const_cast<Id&>(id), depth);
 }
 
 Subtree TreeBase::sub(NodeNum n, const NodeFilter& filter) {
-    return Subtree(
-        env_, this, id::nth_node(env_->node_manager(), root(), n, filter));
+    NodeManager& nm = env_->node_manager();
+    NodeNum depth;
+    Id& id = (is_indexed_ && filter.arity.empty())
+        ? const_cast<Id&>(
+            index().nth(nm, root(), n, filter.is_terminal, depth))
+        : id::nth_node(nm, root(), n, filter, depth);
+    return Subtree(env_, this, id, depth);
 }
 
 const Subtree TreeBase::term(NodeNum n) const {
@@ -119,12 +161,14 @@ const Subtree TreeBase::argument(Arity n) const {
     return Subtree(
         env_,
         const_cast<TreeBase*>(this),
-        const_cast<Id&>(id::nth_argument(env_->node_manager(), root(), n)));
+        const_cast<Id&>(id::nth_argument(env_->node_manager(), root(), n)),
+        1);
 }
 
 Subtree TreeBase::argument(Arity n) {
     check_argument_num(n);
-    return Subtree(env_, this, id::nth_argument(env_->node_manager(), root(), n));
+    return Subtree(
+        env_, this, id::nth_argument(env_->node_manager(), root(), n), 1);
 }
 
 const Arity TreeBase::arity() const {
@@ -138,14 +182,25 @@ const TreeDescription& TreeBase::describe() const {
 }
 
 NodeNum TreeBase::width() const {
-    if (width_ == NoNodeNum)
-        update_width();
-    return width_;
+    return describe().width;
+}
+
+const TreeCostBound& TreeBase::cost_bound() const {
+    if (cost_bound_.is_empty())
+        update_cost_bound();
+    return cost_bound_;
+}
+
+void TreeBase::set_indexed(bool indexed) {
+    is_indexed_ = indexed;
+    if (!indexed)
+        index_.clear();
 }
 
 void TreeBase::reset_cache() {
     reset_description();
-    reset_width();
+    reset_cost_bound();
+    index_.clear();
     if (parent_)
         parent_->reset_cache();
 }
@@ -159,17 +214,22 @@ void TreeBase::check_argument_num(Arity n) const {
 
 void TreeBase::update_description() const {
     description_.set_zero();
+    level_sizes_.clear();
     id::for_each_node(
         env_->node_manager(),
         root(),
         [this](const Id& id, NodeNum n, NodeNum depth) {
             // size
             ++description_.size;
-            // depth
-            description_.depth = std::max(description_.depth, depth);
-            // term_num and nonterm_num
+            // depth, nodes are visited by level
+            description_.depth = depth;
+            if (level_sizes_.size() == depth)
+                level_sizes_.push_back(0);
+            ++level_sizes_[depth];
+            // term_num, nonterm_num and width (number of terminals)
             if (id.arity() == 0) {
                 ++description_.term_num;
+                ++description_.width;
             } else {
                 ++description_.nonterm_num;
             }
@@ -177,16 +237,158 @@ void TreeBase::update_description() const {
         });
 }
 
-void TreeBase::update_width() const {
-    width_ = id::subtree_width(env_->node_manager(), root());
+void TreeBase::update_cost_bound() const {
+    cost_bound_ = stree::cost_bound(*env_, root());
+}
+
+const LevelIndex& TreeBase::index() const {
+    if (index_.empty())
+        index_.build(env_->node_manager(), root());
+    return index_;
 }
 
 void TreeBase::reset_description() {
     description_.set_null();
+    level_sizes_.clear();
 }
 
-void TreeBase::reset_width() {
-    width_ = NoNodeNum;
+void TreeBase::reset_cost_bound() {
+    cost_bound_.set_null();
+}
+
+void TreeBase::reset_cache(
+    const Aggregates& old_root,
+    const Aggregates& new_root)
+{
+    description_ = new_root.description;
+    level_sizes_ = new_root.level_sizes;
+    cost_bound_ = new_root.cost_bound;
+    index_.clear();
+    if (parent_)
+        parent_->replace_subtree(old_root, new_root, depth_);
+}
+
+void TreeBase::replace_subtree(
+    const Aggregates& old_subtree,
+    const Aggregates& new_subtree,
+    NodeNum depth)
+{
+
+    // Description
+    if (!description_.is_empty()) {
+        const TreeDescription& old_description = old_subtree.description;
+        const TreeDescription& new_description = new_subtree.description;
+        if (depth != NoNodeNum
+            && !old_description.is_empty()
+            && !new_description.is_empty())
+        {
+            description_.size += new_description.size - old_description.size;
+            description_.term_num +=
+                new_description.term_num - old_description.term_num;
+            description_.nonterm_num +=
+                new_description.nonterm_num - old_description.nonterm_num;
+            description_.width += new_description.width - old_description.width;
+            // Update number of nodes by depth
+            std::size_t level_num = std::max(
+                level_sizes_.size(),
+                depth + new_subtree.level_sizes.size());
+            level_sizes_.resize(level_num, 0);
+            for (std::size_t n = 0; n < old_subtree.level_sizes.size(); ++n)
+                level_sizes_[depth + n] -= old_subtree.level_sizes[n];
+            for (std::size_t n = 0; n < new_subtree.level_sizes.size(); ++n)
+                level_sizes_[depth + n] += new_subtree.level_sizes[n];
+            while (level_sizes_.size() > 1 && level_sizes_.back() == 0)
+                level_sizes_.pop_back();
+            description_.depth = level_sizes_.size() - 1;
+        } else {
+            reset_description();
+        }
+    }
+
+    // Cost bound
+    if (!cost_bound_.is_empty()) {
+        const TreeCostBound& old_bound = old_subtree.cost_bound;
+        const TreeCostBound& new_bound = new_subtree.cost_bound;
+        // Without selects on path to subtree its cost is just added
+        // to total, otherwise do full update when requested
+        if (!old_bound.is_empty()
+            && !new_bound.is_empty()
+            && cost_bound_.select_num == old_bound.select_num)
+        {
+            cost_bound_.min += new_bound.min - old_bound.min;
+            cost_bound_.max += new_bound.max - old_bound.max;
+            cost_bound_.select_num = new_bound.select_num;
+        } else {
+            reset_cost_bound();
+        }
+    }
+
+    // Index
+    if (!index_.empty()) {
+        if (!old_subtree.root.empty()
+            && !new_subtree.root.empty()
+            && !(new_subtree.root == root()))
+        {
+            index_.replace(
+                env_->node_manager(), old_subtree.parent,
+                old_subtree.root, new_subtree.root);
+        } else {
+            index_.clear();
+        }
+    }
+
+    if (parent_) {
+        NodeNum parent_depth = (depth != NoNodeNum && depth_ != NoNodeNum)
+            ? depth + depth_
+            : NoNodeNum;
+        parent_->replace_subtree(old_subtree, new_subtree, parent_depth);
+    }
+}
+
+void TreeBase::parent_caches(
+    bool& description,
+    bool& cost_bound,
+    bool& index) const
+{
+    for (const TreeBase* tree = parent_; tree; tree = tree->parent_) {
+        description |= !tree->description_.is_empty();
+        cost_bound |= !tree->cost_bound_.is_empty();
+        index |= !tree->index_.empty();
+    }
+}
+
+void TreeBase::compact_index() {
+    for (TreeBase* tree = parent_; tree; tree = tree->parent_)
+        tree->index_.compact(env_->node_manager(), tree->root());
+}
+
+TreeBase::Aggregates TreeBase::aggregates(
+    bool description,
+    bool cost_bound,
+    bool index) const
+{
+    Aggregates result;
+    // Root not set yet, parent caches are reset
+    if (root().empty())
+        return result;
+    if (description) {
+        result.description = describe();
+        result.level_sizes = level_sizes_;
+    }
+    if (cost_bound)
+        result.cost_bound = this->cost_bound();
+    if (index) {
+        result.root = root();
+        // Parent node is same for all parent trees
+        // except ones where root is tree root
+        for (const TreeBase* tree = parent_; tree; tree = tree->parent_) {
+            if (!tree->index_.empty()) {
+                result.parent = tree->index_.parent(root());
+                break;
+            }
+        }
+    }
+    return result;
 }
 
 
@@ -198,9 +400,23 @@ void Subtree::destroy() {
 }
 
 void Subtree::swap(Subtree& other) {
+    // Cached values of parents are updated from subtree ones,
+    // which are calculated only if needed
+    bool description = false;
+    bool cost_bound = false;
+    bool index = false;
+    parent_caches(description, cost_bound, index);
+    other.parent_caches(description, cost_bound, index);
+    Aggregates aggregates =
+        this->aggregates(description, cost_bound, index);
+    Aggregates other_aggregates =
+        other.aggregates(description, cost_bound, index);
     std::swap(root_, other.root_);
-    reset_cache();
-    other.reset_cache();
+    reset_cache(aggregates, other_aggregates);
+    other.reset_cache(other_aggregates, aggregates);
+    // Indices are consistent only after both subtrees are updated
+    compact_index();
+    other.compact_index();
 }
 
 void Subtree::swap(Subtree&& other) {
@@ -235,15 +451,24 @@ Tree::Tree(Environment* env, const Value& value)
 Tree::Tree(const Tree& other)
     : TreeBase(other.env_)
 {
+    is_indexed_ = other.is_indexed_;
     copy(other);
 }
 
 Tree::Tree(Tree&& other)
     : TreeBase(other.env_)
 {
+    is_indexed_ = other.is_indexed_;
     copy(std::move(other));
 }
 
+Tree::Tree(Environment* env, const Tree& other)
+    : TreeBase(env),
+      root_(id::copy_subtree(
+                env->node_manager(),
+                other.env()->node_manager(),
+                other.root_)) {}
+
 Tree::~Tree() {
     id::destroy_subtree(env_->node_manager(), root_);
 }
@@ -263,11 +488,13 @@ Tree& Tree::operator=(Tree&& other) {
 void Tree::copy(const Tree& other) {
     id::destroy_subtree(env_->node_manager(), root_);
     root_ = id::copy_subtree(env_->node_manager(), other.root_);
+    reset_cache();
 }
 
 void Tree::copy(Tree&& other) {
     id::destroy_subtree(env_->node_manager(), root_);
     root_ = id::move(other.root_);
+    reset_cache();
 }
 
 void Tree::swap(Tree& other) {
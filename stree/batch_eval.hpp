@@ -0,0 +1,149 @@
+#ifndef STREE_BATCH_EVAL_HPP_
+#define STREE_BATCH_EVAL_HPP_
+
+#include <cstddef>
+#include <vector>
+#include <stree/environment.hpp>
+#include <stree/eval.hpp>
+#include <stree/tree.hpp>
+
+namespace stree {
+
+// Fitness cases stored by column: column N contains values
+// of positional argument N for all rows.
+class ParamMatrix {
+public:
+    ParamMatrix()
+        : column_num_(0),
+          row_num_(0) {}
+
+    ParamMatrix(std::size_t column_num, std::size_t row_num)
+        : column_num_(column_num),
+          row_num_(row_num),
+          data_(column_num * row_num) {}
+
+    // Make from list of rows, missing values are set to zero
+    ParamMatrix(const std::vector<Params>& rows);
+
+    std::size_t column_num() const {
+        return column_num_;
+    }
+
+    std::size_t row_num() const {
+        return row_num_;
+    }
+
+    const Value* column(std::size_t n) const;
+    Value* column(std::size_t n);
+
+    const Value& at(std::size_t row, std::size_t column) const;
+    Value& at(std::size_t row, std::size_t column);
+
+    Params row(std::size_t row) const;
+    void set_row(std::size_t row, const Params& params);
+
+private:
+    std::size_t column_num_;
+    std::size_t row_num_;
+    std::vector<Value> data_;
+};
+
+
+// Evaluates tree over blocks of rows, each node is evaluated once
+// per block. Functions with batch kernel (see Environment::add_function)
+// are called once per block, other functions are called for each row.
+// Select nodes evaluate non-argument branches only for
+// rows where branch was selected.
+// NOTE: results are same as for `eval' called for each row,
+// but functions are called node by node, not row by row, so functions
+// with side effects are called in different order.
+class BatchEval {
+public:
+    static const std::size_t DefaultBlockSize = 256;
+
+    BatchEval(std::size_t block_size = DefaultBlockSize);
+
+    // Evaluate for all rows, `out' should have space for params.row_num() values
+    void eval(
+        const Environment& env,
+        const Id& root,
+        const ParamMatrix& params,
+        Value* out,
+        DataPtr data = nullptr);
+
+    // Evaluate for rows [first_row, first_row + row_num)
+    void eval(
+        const Environment& env,
+        const Id& root,
+        const ParamMatrix& params,
+        std::size_t first_row,
+        std::size_t row_num,
+        Value* out,
+        DataPtr data = nullptr);
+
+    std::size_t block_size() const {
+        return block_size_;
+    }
+
+private:
+    using RowIndex = std::size_t;
+    using RowIndexList = std::vector<RowIndex>;
+
+    // Rows to evaluate node for: [first, first + size) if `list' is empty,
+    // absolute row numbers from `list' otherwise
+    struct Rows {
+        Rows(RowIndex first, std::size_t size)
+            : first(first), list(nullptr), size(size) {}
+        Rows(const RowIndex* list, std::size_t size)
+            : first(0), list(list), size(size) {}
+
+        RowIndex operator[](std::size_t n) const {
+            return list ? list[n] : first + n;
+        }
+
+        RowIndex first;
+        const RowIndex* list;
+        std::size_t size;
+    };
+
+    // Returns pointer to results, either `out' or column data
+    const Value* eval_node(const Id& id, const Rows& rows, Value* out);
+    const Value* eval_positional(const Id& id, const Rows& rows, Value* out);
+    const Value* eval_function(const Id& id, const Rows& rows, Value* out);
+    const Value* eval_select(const Id& id, const Rows& rows, Value* out);
+
+    Value* acquire_values();
+    void release_values(unsigned n = 1);
+    RowIndex* acquire_indices();
+    void release_indices(unsigned n = 1);
+
+    std::size_t block_size_;
+    const Environment* env_;
+    const ParamMatrix* params_;
+    DataPtr data_;
+
+    std::vector<std::vector<Value>> value_buffers_;
+    std::size_t value_buffers_used_;
+    std::vector<RowIndexList> index_buffers_;
+    std::size_t index_buffers_used_;
+    Arguments arguments_;
+    std::vector<const Value*> argument_columns_;
+};
+
+
+void eval_batch(
+    const Environment& env,
+    const Id& root,
+    const ParamMatrix& params,
+    Value* out,
+    DataPtr data = nullptr);
+
+void eval_batch(
+    const Tree& tree,
+    const ParamMatrix& params,
+    Value* out,
+    DataPtr data = nullptr);
+
+} // namespace stree
+
+#endif
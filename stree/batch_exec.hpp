@@ -0,0 +1,176 @@
+#ifndef STREE_BATCH_EXEC_HPP_
+#define STREE_BATCH_EXEC_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include <stree/environment.hpp>
+#include <stree/eval.hpp>
+#include <stree/exec.hpp>
+#include <stree/tree.hpp>
+
+namespace stree {
+
+// Agent kernel: out[i] = f(args[0][i], ..., args[arity-1][i], data[i])
+// for i < n, called once for group of agents evaluating same node
+using AgentFunction = std::function<
+    void(const Value* const* args, Value* out, std::size_t n,
+         const DataPtr* data)>;
+
+// Executes same tree for many agents in lockstep, each agent has its own
+// parameters, data and state and is stepped as with Exec (same flags).
+// Agents are advanced together: on each round ready nodes of deepest
+// agents are evaluated, agents evaluating same node are grouped, so
+// agents that took different branches join again when returning
+// to common parent. Function with agent kernel (see set_agent_function)
+// is called once per group, other functions are called for each agent.
+// With Exec::FlagNoThrow agent that exceeds cost limit is stopped
+// with Exec::StatusCostLimitExceeded, other agents continue.
+// NOTE: results for each agent are same as with Exec, but calls
+// for different agents are interleaved differently.
+class BatchExec {
+public:
+    using Flag = Exec::Flag;
+    using Status = Exec::Status;
+
+    BatchExec(const TreeBase& tree, Flag flags = Exec::DefaultFlags)
+        : BatchExec(*tree.env(), tree.root(), flags) {}
+
+    BatchExec(
+        const Environment& env,
+        const Id& root,
+        Flag flags = Exec::DefaultFlags);
+
+    void set_agent_function(FunctionIndex fid, AgentFunction function);
+    void set_agent_function(const std::string& name, AgentFunction function);
+
+    // Returns agent index
+    std::size_t add_agent(Params* params, DataPtr data = nullptr);
+
+    std::size_t agent_num() const {
+        return agents_.size();
+    }
+
+    // Step all agents until each one stops, returns
+    // StatusCostLimitExceeded if cost limit is exceeded by any agent
+    Status step();
+    // Step until all agents are finished or exceed cost limit,
+    // forever with Exec::FlagRunLoop
+    Status run();
+    void restart();
+
+    void set_flag(Flag flag) {
+        flags_ |= flag;
+    }
+
+    void unset_flag(Flag flag) {
+        flags_ &= ~flag;
+    }
+
+    bool has_flag(Flag flag) const {
+        return flags_ & flag;
+    }
+
+    // Limit for each agent
+    void set_cost_limit(Cost cost) {
+        cost_limit_ = cost;
+    }
+
+    Cost cost_limit() const {
+        return cost_limit_;
+    }
+
+    bool has_cost_limit() const {
+        return cost_limit_ > 0;
+    }
+
+    // All agents are finished
+    bool is_finished() const;
+
+    bool is_finished(std::size_t agent) const {
+        return agents_[agent].is_finished;
+    }
+
+    // Status of last agent step
+    Status status(std::size_t agent) const {
+        return agents_[agent].status;
+    }
+
+    const Value& result(std::size_t agent) const {
+        return agents_[agent].result;
+    }
+
+    Cost cost_used(std::size_t agent) const {
+        return agents_[agent].cost_used;
+    }
+
+    // Statistics: number of node evaluations by agents
+    // and number of groups they were done in
+    std::size_t node_eval_num() const {
+        return node_eval_num_;
+    }
+
+    std::size_t group_eval_num() const {
+        return group_eval_num_;
+    }
+
+private:
+    struct Frame {
+        Frame(const Id& id, Arity argument_num, std::size_t base)
+            : id(id), argument_num(argument_num), base(base) {}
+
+        Id id;
+        Arity argument_num;
+        std::size_t base;
+    };
+
+    struct Agent {
+        Params* params;
+        DataPtr data;
+        Cost cost_used;
+        bool is_finished;
+        bool is_stopped;
+        Exec::Status status;
+        Value result;
+        std::vector<Frame> stack;
+        std::vector<Value> values;
+    };
+
+    // Step agents until each one stops
+    Status advance(bool restart_finished, bool retry_exceeded);
+    // Push arguments until top node is ready to be evaluated
+    void descend(Agent& agent);
+    // Evaluate node for group of agents, marks agents that should stop
+    void eval_group(std::size_t* group, std::size_t size);
+    void eval_function(const std::size_t* group, std::size_t size);
+    bool should_stop(const Agent& agent, Cost cost, Type type) const;
+
+    void agent_restart(Agent& agent);
+    void agent_push(Agent& agent, const Id& id);
+    void agent_return(Agent& agent, Value value);
+    void agent_pop(Agent& agent);
+
+    const Environment& env_;
+    const Id& root_;
+    Flag flags_;
+    Cost cost_limit_;
+    std::vector<Agent> agents_;
+    std::vector<AgentFunction> agent_functions_; // by fid
+
+    // Buffers
+    std::vector<std::size_t> active_;
+    std::vector<std::size_t> ready_;
+    std::vector<Value> columns_;
+    std::vector<const Value*> column_ptrs_;
+    std::vector<Value> out_;
+    std::vector<DataPtr> data_;
+    EvalContext context_;
+
+    std::size_t node_eval_num_;
+    std::size_t group_eval_num_;
+};
+
+} // namespace stree
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef STREE_BUILTINS_HPP_
+#define STREE_BUILTINS_HPP_
+
+#include <string>
+#include <vector>
+#include <stree/environment.hpp>
+#include <stree/types.hpp>
+
+namespace stree {
+
+// Built-in functions with batch kernels
+//
+// Arithmetic:
+//   "+", "-", "*", "%" (protected division, x / 0 = 1)
+//   "min", "max"
+// Comparison (1 if true, 0 otherwise):
+//   "<", "<=", ">", ">=", "==", "!="
+
+struct Builtin {
+    const char* name;
+    Arity arity;
+    Function function;
+    BatchFunction batch_function;
+};
+
+// Returns nullptr if built-in function not found
+const Builtin* find_builtin(const std::string& name);
+
+std::vector<std::string> builtin_names();
+
+// Add built-in function with its own name
+void add_builtin(Environment& env, const std::string& builtin, Cost cost = 0);
+
+// Add built-in function with different name
+void add_builtin(
+    Environment& env,
+    const std::string& name,
+    const std::string& builtin,
+    Cost cost = 0);
+
+} // namespace stree
+
+#endif
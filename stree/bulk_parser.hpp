@@ -0,0 +1,82 @@
+#ifndef STREE_BULK_PARSER_HPP_
+#define STREE_BULK_PARSER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stree/environment.hpp>
+#include <stree/parser.hpp>
+#include <stree/tree.hpp>
+
+namespace stree {
+
+// Parser for many whitespace-separated trees in single buffer,
+// e.g. population dump, same syntax as Parser.
+// Input is parsed in two passes: first pass checks syntax, counts
+// nodes to reserve pool capacity and records symbol of each token,
+// second pass makes nodes from recorded tokens. Symbol names are looked up
+// in symbol table without copying.
+// NOTE: symbols are cached, parser should not be used after symbols
+// are changed with methods other than adding new ones
+// Errors are reported with ParserError, no nodes are made in that case.
+class BulkParser {
+public:
+    BulkParser(Environment* env);
+
+    std::vector<Id> parse(const char* data, std::size_t size);
+
+    std::vector<Id> parse(const std::string& s) {
+        return parse(s.data(), s.size());
+    }
+
+    // Parse memory-mapped file
+    std::vector<Id> parse_file(const std::string& path);
+
+    // Make trees from parsed roots
+    std::vector<Tree> make_trees(std::vector<Id>&& roots);
+
+private:
+    struct Frame {
+        Id id;
+        Arity arity;
+        Arity child_num;
+    };
+
+    // Symbol data is copied to make nodes without accessing symbol
+    struct Entry {
+        Type type;
+        Arity arity;
+        bool is_callable;
+        std::uint8_t index; // position, function or select function index
+        Value value;
+    };
+
+    // Returns number of trees
+    std::size_t check(const char* data, std::size_t size);
+    void make(std::vector<Id>& roots);
+    Id make_node(const Entry& entry);
+
+    void update_symbols();
+    const Entry* find_symbol(std::string_view name) const;
+
+    [[noreturn]] void error(
+        Parser::Error error,
+        const char* data,
+        std::size_t pos) const;
+
+    Environment* env_;
+    std::vector<Entry> entries_; // by symbol index in symbol table
+    Entry number_entry_; // token entry for numbers
+    std::vector<std::size_t> counts_; // node number by type and arity
+    std::vector<Frame> stack_;
+    // Recorded tokens: symbol entry, &number_entry_ for numbers
+    // (values are stored separately), nullptr for right paren
+    std::vector<const Entry*> tokens_;
+    std::vector<Value> values_;
+};
+
+} // namespace stree
+
+#endif
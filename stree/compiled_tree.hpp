@@ -0,0 +1,81 @@
+#ifndef STREE_COMPILED_TREE_HPP_
+#define STREE_COMPILED_TREE_HPP_
+
+#include <cstdint>
+#include <vector>
+#include <stree/environment.hpp>
+#include <stree/eval.hpp>
+#include <stree/tree.hpp>
+
+namespace stree {
+
+// Tree flattened into postfix instruction array.
+// Intended for evaluating same tree many times with different
+// parameters, results are same as for `eval'.
+// NOTE: evaluation buffers are reused, so single compiled tree
+// cannot be evaluated concurrently.
+class CompiledTree {
+public:
+    enum Opcode : std::uint8_t {
+        OpConst,
+        OpPositional,
+        OpFunction,
+        OpSelect,
+        OpJump
+    };
+
+    struct Instruction {
+        Opcode opcode;
+        Arity arity;
+        Arity argument_num; // number of values popped from stack
+        union {
+            Value value;
+            Position position;
+            FunctionIndex fid;
+            SelectFunctionIndex sfid;
+        };
+        // OpSelect: offset of branch table, OpJump: target address
+        std::uint32_t jump;
+    };
+    using InstructionList = std::vector<Instruction>;
+    using Address = std::uint32_t;
+    using AddressList = std::vector<Address>;
+
+    CompiledTree(const TreeBase& tree)
+        : CompiledTree(*tree.env(), tree.root()) {}
+
+    CompiledTree(const Environment& env, const Id& root);
+
+    Value eval(const Params& params, DataPtr data = nullptr) const;
+
+    const InstructionList& instructions() const {
+        return instructions_;
+    }
+
+    std::size_t size() const {
+        return instructions_.size();
+    }
+
+private:
+    void compile(const Id& id);
+    void compile_select(const Id& id);
+    Address emit(Instruction instruction);
+    void push(unsigned n = 1);
+    void pop(unsigned n);
+
+    const Environment* env_;
+    InstructionList instructions_;
+    // Select branch addresses, for branches evaluated as select
+    // function arguments address of select end is stored
+    AddressList branches_;
+    unsigned stack_size_;
+    unsigned stack_size_max_;
+
+    mutable std::vector<Value> stack_;
+    // used to call functions
+    mutable EvalContext context_;
+};
+
+} // namespace stree
+
+#endif
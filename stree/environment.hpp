@@ -1,6 +1,7 @@
 #ifndef STREE_ENVIRONMENT_HPP_
 #define STREE_ENVIRONMENT_HPP_
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <stree/environment/symbol.hpp>
@@ -11,10 +12,13 @@
 
 namespace stree {
 
+class Tree;
+
 class Environment {
 public:
     Environment()
-        : symbol_table_(this) {}
+        : origin_(this),
+          symbol_table_(this) {}
     Environment(const Environment& other) = delete;
     Environment& operator=(const Environment& other) = delete;
 
@@ -23,7 +27,31 @@ public:
         Arity arity,
         Function function,
         Cost cost = 0);
-    Function function(FunctionIndex fid) const;
+    // Add function with batch kernel (see batch_eval.hpp)
+    void add_function(
+        const std::string& name,
+        Arity arity,
+        Function function,
+        BatchFunction batch_function,
+        Cost cost = 0);
+    // Add function taking arguments as span,
+    // `function(fid)' returns adapter for compatibility
+    void add_span_function(
+        const std::string& name,
+        Arity arity,
+        SpanFunction function,
+        Cost cost = 0);
+    void add_span_function(
+        const std::string& name,
+        Arity arity,
+        SpanFunction function,
+        BatchFunction batch_function,
+        Cost cost = 0);
+    const Function& function(FunctionIndex fid) const;
+    bool has_span_function(FunctionIndex fid) const;
+    const SpanFunction& span_function(FunctionIndex fid) const;
+    bool has_batch_function(FunctionIndex fid) const;
+    const BatchFunction& batch_function(FunctionIndex fid) const;
 
     void add_select_function(
         const std::string& name,
@@ -31,7 +59,16 @@ public:
         Arity cond_arity,
         SelectFunction select_function,
         Cost cost = 0);
-    SelectFunction select_function(SelectFunctionIndex sfid) const;
+    void add_span_select_function(
+        const std::string& name,
+        Arity arity,
+        Arity cond_arity,
+        SpanSelectFunction select_function,
+        Cost cost = 0);
+    const SelectFunction& select_function(SelectFunctionIndex sfid) const;
+    bool has_span_select_function(SelectFunctionIndex sfid) const;
+    const SpanSelectFunction& span_select_function(
+        SelectFunctionIndex sfid) const;
 
     void add_positional(const std::string& name, Position position);
 
@@ -54,12 +91,55 @@ public:
         return symbol_table_;
     }
 
+    // Make environment with same symbols and functions, but with its own
+    // node manager, so that trees can be built on other thread.
+    // Trees are moved back with merge, symbols should not be added
+    // to shard or original environment while shard is in use.
+    std::unique_ptr<Environment> make_shard() const;
+
+    // Move all nodes of `shard' to this environment without copying,
+    // returns trees moved from `shard'. `shard' and this environment
+    // should be made from same environment with make_shard.
+    // NOTE: trees not in the list and their subtrees become invalid
+    std::vector<Tree> merge(Environment& shard, std::vector<Tree>&& trees);
+
+    // Move nodes of `trees' to dense prefix of node pools,
+    // see NodeManager::compact.
+    // NOTE: all trees of this environment should be in the list,
+    // subtree references become invalid
+    void compact(std::vector<Tree>& trees, NodeOrder order = NodeOrderDfs);
+
+    // Environment shard was made from, or this environment
+    const Environment* origin() const {
+        return origin_;
+    }
+
 private:
     void add_symbol(const SymbolPtr& symbol);
 
+    void add_function(
+        const std::string& name,
+        Arity arity,
+        Function function,
+        SpanFunction span_function,
+        BatchFunction batch_function,
+        Cost cost);
+
+    void add_select_function(
+        const std::string& name,
+        Arity arity,
+        Arity cond_arity,
+        SelectFunction select_function,
+        SpanSelectFunction span_select_function,
+        Cost cost);
+
     std::vector<Function> functions_;
+    std::vector<SpanFunction> span_functions_;
+    std::vector<BatchFunction> batch_functions_;
     std::vector<SelectFunction> select_functions_;
+    std::vector<SpanSelectFunction> span_select_functions_;
 
+    const Environment* origin_;
     SymbolTable symbol_table_;
     NodeManager node_manager_;
 };
@@ -2,8 +2,10 @@
 #define STREE_ENVIRONMENT_SYMBOL_TABLE_HPP_
 
 #include <cstddef>
+#include <cstdint>
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stree/environment/symbol.hpp>
 #include <stree/types.hpp>
@@ -13,8 +15,15 @@ namespace stree {
 class Id;
 class Environment;
 
+// Positionals, functions and select functions are stored in dense
+// tables indexed by position/fid/sfid, names are looked up in
+// open addressing hash table. Tables are updated when symbol is added.
+// by_* methods throw std::out_of_range if symbol is not found,
+// find* methods return empty pointer instead.
 class SymbolTable {
 public:
+    static constexpr std::size_t NoIndex = static_cast<std::size_t>(-1);
+
     SymbolTable(const Environment* env)
         : env_(env) {}
 
@@ -31,6 +40,28 @@ public:
     const SymbolPtr& by_fid(FunctionIndex fid) const;
     const SymbolPtr& by_sfid(SelectFunctionIndex sfid) const;
 
+    // Returns empty pointer for constant
+    const SymbolPtr& find_by_id(const Id& id) const;
+    const SymbolPtr& find(std::string_view name) const;
+    // Symbol index for operator[], NoIndex if not found
+    std::size_t find_index(std::string_view name) const;
+
+    const SymbolPtr& find_by_position(Position position) const {
+        return (position < positionals_.size())
+            ? positionals_[position]
+            : NoSymbol;
+    }
+
+    const SymbolPtr& find_by_fid(FunctionIndex fid) const {
+        return (fid < functions_.size()) ? functions_[fid] : NoSymbol;
+    }
+
+    const SymbolPtr& find_by_sfid(SelectFunctionIndex sfid) const {
+        return (sfid < select_functions_.size())
+            ? select_functions_[sfid]
+            : NoSymbol;
+    }
+
     const SymbolPtrList& terminals() const {
         return terminals_;
     }
@@ -40,33 +71,36 @@ public:
     }
 
 private:
-    using SymbolPtrMap = std::map<const std::string, SymbolPtr>;
     using SymbolPtrListArityMap = std::map<const Arity, SymbolPtrList>;
-    using PositionalMap = std::map<const Position, SymbolPtr>;
-    using FunctionMap = std::map<const FunctionIndex, SymbolPtr>;
-    using SelectFunctionMap = std::map<const SelectFunctionIndex, SymbolPtr>;
 
-    void add_to_map(const SymbolPtr& symbol);
+    static const SymbolPtr NoSymbol;
+
+    void add_to_name_table(const SymbolPtr& symbol);
+    void insert_to_name_table(std::uint32_t index);
     void add_to_list(const SymbolPtr& symbol);
     void add_to_term_list(const SymbolPtr& symbol);
     void add_to_arity_list(const SymbolPtr& symbol);
     void add_to_type_map(const SymbolPtr& symbol);
 
-    void add_to_positional_map(const SymbolPtr& symbol);
-    void add_to_function_map(const SymbolPtr& symbol);
-    void add_to_select_function_map(const SymbolPtr& symbol);
+    void add_to_index_table(
+        SymbolPtrList& table,
+        std::uint8_t index,
+        const SymbolPtr& symbol,
+        const char* kind,
+        const char* index_name);
 
     const Environment* env_;
 
     SymbolPtrList list_;
-    SymbolPtrMap map_;
+    // Symbol index in list_ + 1, zero for unused slot; size is power of 2
+    std::vector<std::uint32_t> name_table_;
     SymbolPtrList terminals_; // NOTE: redundant (same as list_arity_map_[0])
     SymbolPtrList nonterminals_;
     SymbolPtrListArityMap list_arity_map_;
 
-    PositionalMap positional_map_;
-    FunctionMap function_map_;
-    SelectFunctionMap select_function_map_;
+    SymbolPtrList positionals_;
+    SymbolPtrList functions_;
+    SymbolPtrList select_functions_;
 };
 
 }
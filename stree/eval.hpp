@@ -1,14 +1,68 @@
 #ifndef STREE_EVAL_HPP_
 #define STREE_EVAL_HPP_
 
+#include <cstddef>
 #include <vector>
 #include <stree/environment.hpp>
 #include <stree/tree.hpp>
 
 namespace stree {
 
+class FrozenTree;
+
 using Params = std::vector<Value>;
 
+// Reusable evaluation state. Arguments of all functions being evaluated
+// are kept on single value stack and passed to span functions
+// (see Environment::add_span_function) without copying; `Arguments'
+// buffer is reused for other functions. Once stack has grown
+// to tree depth, evaluation does not allocate memory.
+// NOTE: functions should not eval trees using same context.
+class EvalContext {
+public:
+    EvalContext() {}
+
+    void reserve(std::size_t size) {
+        stack_.reserve(size);
+    }
+
+    // Call function with argument span
+    Value call_function(
+        const Environment& env,
+        FunctionIndex fid,
+        ArgumentSpan arguments,
+        DataPtr data = nullptr);
+
+    unsigned call_select_function(
+        const Environment& env,
+        SelectFunctionIndex sfid,
+        ArgumentSpan arguments,
+        DataPtr data = nullptr);
+
+private:
+    friend class FrozenTree;
+    friend Value eval(
+        EvalContext& context,
+        const Environment& env,
+        const Id& id,
+        const Params& params, DataPtr data);
+
+    Value eval_node(
+        const Environment& env,
+        const Id& id,
+        const Params& params, DataPtr data);
+
+    // Push evaluated arguments to stack, returns stack size before push
+    std::size_t push_arguments(
+        const Environment& env,
+        const Id& id,
+        Arity argument_num,
+        const Params& params, DataPtr data);
+
+    std::vector<Value> stack_;
+    Arguments arguments_;
+};
+
 Value eval(
     const Environment& env,
     const Id& id,
@@ -16,6 +70,17 @@ Value eval(
 
 Value eval(const Tree& tree, const Params& params, DataPtr data = nullptr);
 
+Value eval(
+    EvalContext& context,
+    const Environment& env,
+    const Id& id,
+    const Params& params, DataPtr data = nullptr);
+
+Value eval(
+    EvalContext& context,
+    const Tree& tree,
+    const Params& params, DataPtr data = nullptr);
+
 // TODO: refactoring ??
 Arity get_argument_num(const Environment& env, const Id& id);
 
@@ -31,6 +96,9 @@ unsigned call_select_function(
     const Arguments& arguments,
     DataPtr data = nullptr);
 
+// Static bounds for cost of single evaluation by Exec
+TreeCostBound cost_bound(const Environment& env, const Id& id);
+
 }
 
 #endif
@@ -1,10 +1,14 @@
 #ifndef STREE_EXEC_HPP_
 #define STREE_EXEC_HPP_
 
+#include <cstddef>
 #include <cstdint>
+#include <istream>
+#include <memory>
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 #include <stree/environment.hpp>
 #include <stree/eval.hpp>
@@ -18,9 +22,22 @@ class ExecCostLimitExceeded : public std::exception {
 
 
 class ExecDebug;
-
+class ExecSnapshot;
+
+// Step-by-step tree execution. step() runs until stop condition set by
+// flags is met, run() steps until tree is evaluated (or forever with
+// FlagRunLoop). Execution is iterative, arguments are kept on single
+// value stack, so it does not allocate once stacks have grown
+// to tree depth.
+// If cost limit is exceeded, ExecCostLimitExceeded is thrown, or with
+// FlagNoThrow step()/run() stop before evaluating top frame and return
+// StatusCostLimitExceeded, execution can be continued after limit is raised.
+// Execution state can be saved with snapshot() and restored or forked;
+// frames below top are shared between snapshots and copied only
+// when execution returns to them.
 class Exec {
     friend ExecDebug;
+    friend ExecSnapshot;
 public:
     using Flag = std::uint8_t;
     const static Flag NoFlags               = 0;
@@ -29,9 +46,15 @@ public:
     const static Flag FlagStopIfCostNotZero = 4;
     const static Flag FlagStopOnFunctions   = 8;
     const static Flag FlagStopOnSelects     = 16;
+    const static Flag FlagNoThrow           = 32;
     const static Flag DefaultFlags          = NoFlags; // FlagStopOnFinished;
     const static Flag AllFlags              = -1;
 
+    enum Status {
+        StatusOk,
+        StatusCostLimitExceeded
+    };
+
     Exec(const TreeBase& tree, Flag flags = DefaultFlags)
         : Exec(*tree.env(), tree.root(), flags) {}
 
@@ -43,14 +66,31 @@ public:
           cost_limit_(-1),
           cost_used_(0),
           data_ptr_(nullptr),
+          status_(StatusOk),
           is_finished_(false),
           result_(Value{}) {}
 
     void init(Params* params, DataPtr data_ptr = nullptr);
-    void run();
-    void step();
+    Status run();
+    Status step();
     void restart();
 
+    // Save current state, O(number of frames pushed since last snapshot)
+    ExecSnapshot snapshot();
+
+    // Continue from saved state, snapshot should be made by Exec
+    // of same tree; parameters, flags and cost limit are not changed
+    void restore(const ExecSnapshot& snapshot);
+
+    // Make Exec with same state, parameters, flags and cost limit
+    Exec fork();
+
+    // Write/read execution state in binary format, nodes are stored
+    // by number, so state can be loaded for copy of same tree.
+    // Parameters, flags and cost limit are not saved.
+    void save(std::ostream& os);
+    void load(std::istream& is);
+
     void set_flag(Flag flag) {
         flags_ |= flag;
     }
@@ -83,26 +123,52 @@ public:
         return is_finished_;
     }
 
+    // Status of last step
+    Status status() const {
+        return status_;
+    }
+
     const Value& result() const {
         return result_;
     }
 
 private:
-    class Frame {
-    public:
-        Frame(const Id& id, Arity argument_num)
-            : id(id), argument_num(argument_num) {}
-
-        const Id id;
-        const Arity argument_num;
-        Arguments arguments;
+    // Arguments of all frames are kept on single value stack,
+    // frame arguments start at `base'
+    struct Frame {
+        Frame(const Id& id, Arity argument_num, std::size_t base)
+            : id(id), argument_num(argument_num), base(base) {}
+
+        Id id;
+        Arity argument_num;
+        std::size_t base;
     };
 
     using Stack = std::vector<Frame>;
 
-    void eval_top();
+    // Frozen stack part shared between snapshots, frames [0, frame_num)
+    // of segment are live, segment frames are above parent ones
+    struct Segment;
+    struct StackView {
+        std::shared_ptr<const Segment> segment;
+        std::size_t frame_num = 0;
+    };
+
+    // Frame arguments are stored in `values' from frame base
+    // to next frame base
+    struct Segment {
+        StackView parent;
+        Stack frames;
+        std::vector<Value> values;
+    };
+
+    // Returns true if execution should stop
+    bool eval_top();
     void push_argument();
 
+    // Move top frozen frame to local stack
+    void thaw();
+
     void stack_clear();
     void stack_push(const Id& id);
     void stack_return(Value value);
@@ -110,9 +176,13 @@ private:
     Frame& stack_top();
     bool stack_empty() const;
 
-    // debug
-    Frame& stack_frame(unsigned n);
-    unsigned stack_size() const;
+    // Number of evaluated arguments of top frame
+    std::size_t top_argument_num() const {
+        return values_.size() - stack_.back().base;
+    }
+
+    // All frames with arguments from bottom to top
+    std::vector<std::pair<Frame, ArgumentSpan>> frames() const;
 
     const Environment& env_;
     const Id& root_;
@@ -121,8 +191,41 @@ private:
     Cost cost_limit_;
     Cost cost_used_;
     DataPtr data_ptr_;
+    StackView frozen_; // frames below local stack
     Stack stack_;
+    std::vector<Value> values_;
+    EvalContext context_;
 
+    Status status_;
+    bool is_finished_;
+    Value result_;
+};
+
+
+class ExecSnapshot {
+    friend Exec;
+public:
+    ExecSnapshot()
+        : cost_used_(0),
+          is_finished_(false),
+          result_(Value{}) {}
+
+    Cost cost_used() const {
+        return cost_used_;
+    }
+
+    bool is_finished() const {
+        return is_finished_;
+    }
+
+    const Value& result() const {
+        return result_;
+    }
+
+private:
+    Id root_;
+    Exec::StackView stack_;
+    Cost cost_used_;
     bool is_finished_;
     Value result_;
 };
@@ -143,7 +246,8 @@ public:
 private:
     std::ostream& print_frame(
         std::ostream& os,
-        Exec::Frame& frame,
+        const Exec::Frame& frame,
+        ArgumentSpan arguments,
         PrintFlags flags) const;
 
     Exec& exec_;
@@ -0,0 +1,121 @@
+#ifndef STREE_FROZEN_TREE_HPP_
+#define STREE_FROZEN_TREE_HPP_
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stree/environment.hpp>
+#include <stree/eval.hpp>
+#include <stree/tree.hpp>
+
+namespace stree {
+
+// Node of frozen tree, children follow their parent:
+// first child is next node, next sibling is `size' nodes further
+struct FrozenNode {
+    Type type;
+    Arity arity;
+    Arity argument_num; // number of evaluated arguments
+    union {
+        Value value;
+        Position position;
+        FunctionIndex fid;
+        SelectFunctionIndex sfid;
+    };
+    NodeNum size; // subtree size
+
+    const FrozenNode* first() const {
+        return this + 1;
+    }
+
+    const FrozenNode* next() const {
+        return this + size;
+    }
+
+    const FrozenNode* argument(Arity n) const;
+};
+
+// Immutable tree stored in single contiguous buffer in preorder.
+// Copies share node buffer. Intended for trees that are kept and
+// evaluated for a long time, e.g. hall of fame.
+// Buffer may also be memory-mapped file, see MappedPopulation.
+class FrozenTree {
+public:
+    using NodeList = std::vector<FrozenNode>;
+
+    FrozenTree(const TreeBase& tree)
+        : FrozenTree(*tree.env(), tree.root()) {}
+
+    FrozenTree(const Environment& env, const Id& root);
+
+    Value eval(const Params& params, DataPtr data = nullptr) const;
+
+    // Evaluate using context buffers, same tree can be evaluated
+    // concurrently with different contexts
+    Value eval(
+        EvalContext& context,
+        const Params& params, DataPtr data = nullptr) const;
+
+    // Make mutable copy, `env' should be this tree environment
+    // or its shard
+    Tree to_tree(Environment* env) const;
+
+    bool equal(const TreeBase& tree) const;
+
+    const Environment* env() const {
+        return env_;
+    }
+
+    const FrozenNode& root() const {
+        return *nodes_;
+    }
+
+    const FrozenNode* nodes() const {
+        return nodes_;
+    }
+
+    NodeNum size() const {
+        return size_;
+    }
+
+private:
+    friend class MappedPopulation;
+
+    // Tree stored in external buffer, `storage' keeps it alive
+    FrozenTree(
+        const Environment* env,
+        std::shared_ptr<const void> storage,
+        const FrozenNode* nodes,
+        NodeNum size)
+        : env_(env),
+          storage_(std::move(storage)),
+          nodes_(nodes),
+          size_(size) {}
+
+    void freeze(NodeList& nodes, const Id& id);
+
+    Value eval_node(
+        EvalContext& context,
+        const FrozenNode* node,
+        const Params& params, DataPtr data) const;
+
+    Id thaw(NodeManager& nm, const FrozenNode* node) const;
+
+    const Environment* env_;
+    std::shared_ptr<const void> storage_;
+    const FrozenNode* nodes_;
+    NodeNum size_;
+};
+
+bool operator==(const FrozenTree& tree1, const FrozenTree& tree2);
+bool operator!=(const FrozenTree& tree1, const FrozenTree& tree2);
+
+std::string to_string(const FrozenTree& tree);
+
+} // namespace stree
+
+std::ostream& operator<<(std::ostream& os, const stree::FrozenTree& tree);
+
+#endif
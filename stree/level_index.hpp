@@ -0,0 +1,81 @@
+#ifndef STREE_LEVEL_INDEX_HPP_
+#define STREE_LEVEL_INDEX_HPP_
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include <stree/node.hpp>
+#include <stree/search.hpp>
+#include <stree/types.hpp>
+
+namespace stree {
+
+// Numbers of nodes and terminals by depth for each subtree node,
+// used to find n-th node in BFS order (same as id::nth_node)
+// by descent from root, O(depth * arity) instead of O(size).
+// Index is updated when subtree is replaced, O(depth * subtree depth)
+// plus new subtree size; entries of removed nodes are dropped
+// by compact().
+// NOTE: memory is O(sum of subtree depths), which is O(size * depth)
+// for degenerate trees
+class LevelIndex {
+public:
+    bool empty() const {
+        return entries_.empty();
+    }
+
+    void clear();
+
+    void build(const NodeManager& nm, const Id& root);
+
+    // N-th node matching terminality filter, also returns node depth
+    const Id& nth(
+        const NodeManager& nm,
+        const Id& root,
+        NodeNum n,
+        IsTerminal is_terminal,
+        NodeNum& depth) const;
+
+    // Parent node, empty for root
+    Id parent(const Id& id) const;
+
+    // Subtree of `parent' node replaced, empty parent if root replaced
+    void replace(
+        const NodeManager& nm,
+        const Id& parent,
+        const Id& old_subtree,
+        const Id& new_subtree);
+
+    // Rebuild if there are too many entries of removed nodes,
+    // should be called when tree is consistent again, e.g. after
+    // both subtrees are swapped
+    void compact(const NodeManager& nm, const Id& root);
+
+    // Node ID replaced, arguments are same
+    void replace_id(const NodeManager& nm, const Id& old_id, const Id& new_id);
+
+private:
+    struct LevelCount {
+        NodeNum size;
+        NodeNum term_num;
+    };
+
+    using LevelCountList = std::vector<LevelCount>;
+
+    struct Entry {
+        Id parent;
+        LevelCountList levels;
+    };
+
+    // Add entries for subtree nodes
+    void add(const NodeManager& nm, const Id& id, const Id& parent);
+
+    static NodeNum count(const LevelCount& level, IsTerminal is_terminal);
+
+    std::unordered_map<Id, Entry> entries_;
+    std::size_t size_ = 0; // number of nodes in tree
+};
+
+} // namespace stree
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef STREE_MAPPED_FILE_HPP_
+#define STREE_MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <string>
+
+namespace stree {
+
+// Read-only file mapped to memory, unmapped on destruction
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile& other) = delete;
+    ~MappedFile();
+
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    const char* data() const {
+        return static_cast<const char*>(data_);
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+private:
+    void* data_;
+    std::size_t size_;
+};
+
+} // namespace stree
+
+#endif
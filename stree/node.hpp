@@ -5,5 +5,6 @@
 #include <stree/node/functions.hpp>
 #include <stree/node/manager.hpp>
 #include <stree/node/stats.hpp>
+#include <stree/node/traversal.hpp>
 
 #endif
@@ -42,6 +42,12 @@ Id& nth_argument(NodeManager& nm, Id& id, Arity n);
 Id copy(NodeManager& nm, const Id id);
 Id copy_subtree(NodeManager& nm, const Id root);
 
+// Copy from other manager
+Id copy(NodeManager& nm, const NodeManager& src_nm, const Id id);
+Id copy_subtree(NodeManager& nm, const NodeManager& src_nm, const Id root);
+// Same as copy_subtree, but nodes are allocated in BFS order
+Id copy_subtree_bfs(NodeManager& nm, const NodeManager& src_nm, const Id root);
+
 // Const
 Value value(const NodeManager& nm, const Id& id);
 void set_value(NodeManager& nm, Id& id, Value value);
@@ -66,10 +72,21 @@ Id& nth_node(NodeManager& nm, Id& id, NodeNum n);
 const Id& nth_node(const NodeManager& nm, const Id& id, NodeNum n, const NodeFilter& filter);
 Id& nth_node(NodeManager& nm, Id& id, NodeNum n, const NodeFilter& filter);
 
-void for_each_node(
+// Also returns depth of found node
+const Id& nth_node(
     const NodeManager& nm,
     const Id& id,
-    std::function<bool(const Id&, NodeNum, NodeNum)> callback);
+    NodeNum n,
+    const NodeFilter& filter,
+    NodeNum& depth);
+Id& nth_node(
+    NodeManager& nm,
+    Id& id,
+    NodeNum n,
+    const NodeFilter& filter,
+    NodeNum& depth);
+
+// NOTE: for_each_node and other traversals are in node/traversal.hpp
 
 }} // namespace id, stree
 
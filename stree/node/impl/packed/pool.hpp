@@ -1,8 +1,12 @@
 #ifndef STREE_NODE_IMPL_PACKED_POOL_HPP_
 #define STREE_NODE_IMPL_PACKED_POOL_HPP_
 
+#include <algorithm>
 #include <cassert>
-#include <queue>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <utility>
 #include <vector>
 #include <stree/node/impl/packed/id.hpp>
 #include <stree/node/impl/packed/node.hpp>
@@ -11,50 +15,151 @@ namespace stree {
 
 class NodeManagerStats;
 
-// Pool of nodes of specific type
+// Pool of nodes of specific type.
+// Free slots form intrusive LIFO list, most recently freed slot
+// is reused first.
 template<typename T>
 class NodePool {
     friend NodeManagerStats;
 
 public:
-    NodePool() {}
+    NodePool()
+        : used_(0),
+          free_head_(Id::NoIndex),
+          free_num_(0) {}
     NodePool(const NodePool& other) = delete;
     NodePool& operator=(const NodePool& other) = delete;
 
     Id::Index alloc() {
         Id::Index index = Id::NoIndex;
-        if (buffer_.empty()) {
-            index = nodes_.size();
-            nodes_.emplace_back(T());
+        if (free_head_ != Id::NoIndex) {
+            index = free_head_;
+            free_head_ = nodes_[index].next;
+            --free_num_;
+        } else if (used_ < nodes_.size()) {
+            // reuse node retired by release()
+            index = used_++;
         } else {
-            index = buffer_.front();
-            buffer_.pop();
+            index = nodes_.size();
+            nodes_.emplace_back();
+            ++used_;
+            return index;
         }
-        assert(index != Id::NoIndex);
+        new (&nodes_[index].node) T();
         return index;
     }
 
     T& get(Id::Index index) {
         assert(index != Id::NoIndex);
-        assert(0 <= index && index < nodes_.size());
-        return nodes_[index];
+        assert(0 <= index && index < used_);
+        return nodes_[index].node;
     }
 
     const T& get(Id::Index index) const {
         assert(index != Id::NoIndex);
-        assert(0 <= index && index < nodes_.size());
-        return nodes_[index];
+        assert(0 <= index && index < used_);
+        return nodes_[index].node;
     }
 
     void free(Id::Index index) {
         assert(index != Id::NoIndex);
-        assert(0 <= index && index < nodes_.size());
-        buffer_.push(index);
+        assert(0 <= index && index < used_);
+        nodes_[index].node.~T();
+        nodes_[index].next = free_head_;
+        free_head_ = index;
+        ++free_num_;
+    }
+
+    // Retire all nodes, memory is kept for reuse
+    void release() {
+        used_ = 0;
+        free_head_ = Id::NoIndex;
+        free_num_ = 0;
+    }
+
+    // Number of slots in free list
+    std::size_t free_num() const {
+        return free_num_;
+    }
+
+    // Number of retired nodes
+    std::size_t retired_num() const {
+        return nodes_.size() - used_;
+    }
+
+    // Make room for `num' more nodes
+    void reserve(std::size_t num) {
+        std::size_t available = free_num_ + retired_num();
+        if (num <= available)
+            return;
+        // Grow geometrically, reserve may be called repeatedly
+        std::size_t needed = nodes_.size() + num - available;
+        if (needed > nodes_.capacity())
+            nodes_.reserve(std::max(needed, 2 * nodes_.capacity()));
+    }
+
+    void swap(NodePool& other) {
+        nodes_.swap(other.nodes_);
+        std::swap(used_, other.used_);
+        std::swap(free_head_, other.free_head_);
+        std::swap(free_num_, other.free_num_);
+    }
+
+    // Release memory of retired nodes and unused capacity
+    void shrink() {
+        nodes_.resize(used_);
+        nodes_.shrink_to_fit();
+    }
+
+    // Node indices change when moving nodes to other pool
+    static constexpr bool MergeKeepsIndices = false;
+
+    // Move all nodes from other pool to the end of this one,
+    // returns offset to add to indices of moved nodes
+    Id::Index merge(NodePool& other) {
+        nodes_.resize(used_); // drop retired nodes
+        Id::Index offset = used_;
+        nodes_.insert(
+            nodes_.end(),
+            std::make_move_iterator(other.nodes_.begin()),
+            std::make_move_iterator(other.nodes_.end()));
+        used_ += other.used_;
+
+        // Prepend other free list
+        if (other.free_head_ != Id::NoIndex) {
+            Id::Index index = other.free_head_ + offset;
+            Id::Index head = index;
+            while (nodes_[index].next != Id::NoIndex) {
+                nodes_[index].next += offset;
+                index = nodes_[index].next;
+            }
+            nodes_[index].next = free_head_;
+            free_head_ = head;
+            free_num_ += other.free_num_;
+        }
+
+        other.nodes_.clear();
+        other.release();
+        return offset;
+    }
+
+    static Id::Index merged_index(Id::Index index, Id::Index offset) {
+        return index + offset;
     }
 
 private:
-    std::vector<T> nodes_;
-    std::queue<Id::Index> buffer_;
+    // Node or next free slot index
+    union Slot {
+        Slot() : node() {}
+        ~Slot() {}
+        T node;
+        Id::Index next;
+    };
+
+    std::vector<Slot> nodes_;
+    std::size_t used_; // nodes after first `used_' are retired
+    Id::Index free_head_;
+    std::size_t free_num_;
 };
 
 } // namespace stree
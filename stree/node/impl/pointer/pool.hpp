@@ -1,8 +1,12 @@
 #ifndef STREE_NODE_IMPL_POINTER_NODE_MANAGER_HPP_
 #define STREE_NODE_IMPL_POINTER_NODE_MANAGER_HPP_
 
+#include <algorithm>
 #include <cassert>
-#include <queue>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
 #include <stree/types.hpp>
 #include <stree/macros.hpp>
 #include <stree/node/impl/pointer/id.hpp>
@@ -12,16 +16,22 @@ namespace stree {
 
 class NodeManagerStats;
 
-// Pool of nodes of specific type
+// Pool of nodes of specific type.
+// Free nodes are destroyed and their memory is used to store
+// intrusive LIFO list, most recently freed node is reused first.
 template<typename T>
 class NodePool {
     friend NodeManagerStats;
 
 public:
-    NodePool() {}
+    NodePool()
+        : used_(0),
+          free_head_(nullptr),
+          free_num_(0) {}
     NodePool(const NodePool& other) = delete;
 
     ~NodePool() {
+        revive_free();
         for (Id::Index index : nodes_)
             delete static_cast<T*>(index);
     }
@@ -30,12 +40,19 @@ public:
 
     Id::Index alloc() {
         Id::Index index = Id::NoIndex;
-        if (buffer_.empty()) {
+        if (free_head_) {
+            T* node = free_head_;
+            free_head_ = next_free(node);
+            --free_num_;
+            index = new (node) T();
+        } else if (used_ < nodes_.size()) {
+            // reuse node retired by release()
+            index = nodes_[used_++];
+            static_cast<T&>(*index) = T();
+        } else {
             index = new T();
             nodes_.push_back(index);
-        } else {
-            index = buffer_.front();
-            buffer_.pop();
+            ++used_;
         }
         assert(index != Id::NoIndex);
         return index;
@@ -53,12 +70,115 @@ public:
 
     void free(Id::Index index) {
         assert(index != Id::NoIndex);
-        buffer_.push(index);
+        T* node = static_cast<T*>(index);
+        node->~T();
+        new (static_cast<void*>(node)) FreeSlot{free_head_};
+        free_head_ = node;
+        ++free_num_;
+    }
+
+    // Retire all nodes, memory is kept for reuse
+    void release() {
+        revive_free();
+        used_ = 0;
+    }
+
+    // Number of nodes in free list
+    std::size_t free_num() const {
+        return free_num_;
+    }
+
+    // Number of retired nodes
+    std::size_t retired_num() const {
+        return nodes_.size() - used_;
+    }
+
+    // Make room for `num' more nodes
+    void reserve(std::size_t num) {
+        std::size_t available = free_num_ + retired_num();
+        if (num <= available)
+            return;
+        // Grow geometrically, reserve may be called repeatedly
+        std::size_t needed = nodes_.size() + num - available;
+        if (needed > nodes_.capacity())
+            nodes_.reserve(std::max(needed, 2 * nodes_.capacity()));
+    }
+
+    void swap(NodePool& other) {
+        nodes_.swap(other.nodes_);
+        std::swap(used_, other.used_);
+        std::swap(free_head_, other.free_head_);
+        std::swap(free_num_, other.free_num_);
+    }
+
+    // Release memory of retired nodes and unused capacity
+    void shrink() {
+        for (std::size_t n = used_; n < nodes_.size(); ++n)
+            delete static_cast<T*>(nodes_[n]);
+        nodes_.resize(used_);
+        nodes_.shrink_to_fit();
+    }
+
+    // Nodes are not moved in memory, pointers stay valid
+    static constexpr bool MergeKeepsIndices = true;
+
+    // Take ownership of all nodes from other pool
+    Id::Index merge(NodePool& other) {
+        // insert nodes in use before retired ones
+        auto other_used_end = other.nodes_.begin() + other.used_;
+        nodes_.insert(
+            nodes_.begin() + used_,
+            other.nodes_.begin(),
+            other_used_end);
+        nodes_.insert(nodes_.end(), other_used_end, other.nodes_.end());
+        used_ += other.used_;
+
+        // Prepend other free list
+        if (other.free_head_) {
+            T* node = other.free_head_;
+            while (next_free(node))
+                node = next_free(node);
+            new (static_cast<void*>(node)) FreeSlot{free_head_};
+            free_head_ = other.free_head_;
+            free_num_ += other.free_num_;
+        }
+
+        other.nodes_.clear();
+        other.used_ = 0;
+        other.free_head_ = nullptr;
+        other.free_num_ = 0;
+        return Id::NoIndex;
+    }
+
+    static Id::Index merged_index(Id::Index index, Id::Index) {
+        return index;
     }
 
 private:
+    // Stored in memory of free node
+    struct FreeSlot {
+        T* next;
+    };
+    static_assert(sizeof(FreeSlot) <= sizeof(T), "Node is too small");
+
+    static T* next_free(T* node) {
+        return std::launder(reinterpret_cast<FreeSlot*>(node))->next;
+    }
+
+    // Construct nodes in free list again
+    void revive_free() {
+        while (free_head_) {
+            T* node = free_head_;
+            free_head_ = next_free(node);
+            new (node) T();
+        }
+        free_num_ = 0;
+    }
+
     std::vector<Id::Index> nodes_;
-    std::queue<Id::Index> buffer_;
+    std::size_t used_; // nodes after first `used_' are retired
+    T* free_head_;
+    std::size_t free_num_;
 };
 
 } // namespace stree
@@ -1,11 +1,19 @@
 #ifndef STREE_NODE_MANAGER_HPP_
 #define STREE_NODE_MANAGER_HPP_
 
+#include <cstddef>
+#include <vector>
 #include <stree/macros.hpp>
 #include <stree/node/impl.hpp>
 
 namespace stree {
 
+// Node order for NodeManager::compact
+enum NodeOrder {
+    NodeOrderDfs, // preorder
+    NodeOrderBfs
+};
+
 #define STREE_TMP_MEMBER_DECL(_Type, _member)   \
     private:                                    \
     NodePool<_Type> _member;                    \
@@ -16,10 +24,17 @@ namespace stree {
 #define STREE_TMP_MEMBER_SELECT_DECL(_arity)                    \
     STREE_TMP_MEMBER_DECL(SelectNode<_arity>, select ## _arity)
 
+// Node pools. Allocating and freeing nodes modifies pools,
+// reading nodes does not, so trees can be read (e.g. evaluated)
+// from multiple threads as long as no thread allocates or frees nodes.
+// Frozen manager enforces this by throwing std::logic_error
+// from alloc and free.
 class NodeManager {
     friend NodeManagerStats;
 public:
-    NodeManager() {}
+    NodeManager()
+        : frozen_(false),
+          arena_(false) {}
     NodeManager(const NodeManager& other) = delete;
     NodeManager& operator=(const NodeManager& other) = delete;
 
@@ -35,6 +50,61 @@ public:
     template<typename N, Type type>
     void free(Id::Index index);
 
+    void freeze() {
+        frozen_ = true;
+    }
+
+    void unfreeze() {
+        frozen_ = false;
+    }
+
+    bool is_frozen() const {
+        return frozen_;
+    }
+
+    // Arena mode: freeing nodes does nothing, all nodes are reclaimed
+    // at once with release(), e.g. when discarding a generation.
+    void set_arena(bool arena) {
+        arena_ = arena;
+    }
+
+    bool is_arena() const {
+        return arena_;
+    }
+
+    // Make room for `num' more nodes of given type and arity,
+    // so that allocating them does not reallocate pool
+    void reserve(Type type, Arity arity, std::size_t num);
+
+    // Retire all nodes in O(1) per pool, memory is kept for reuse.
+    // All existing IDs become invalid; trees holding them can only be
+    // destroyed in arena mode.
+    void release();
+
+    // Move all nodes from other manager to this one without copying,
+    // IDs in `roots' and their subtrees are updated to point to
+    // moved nodes. Other IDs referring to nodes of `other' become invalid.
+    void merge(NodeManager& other, std::vector<Id>& roots);
+
+    // Move nodes of `roots' subtrees to dense prefix of each pool,
+    // nodes of each tree are placed in given order, other nodes are
+    // discarded and unused memory is released. IDs in `roots' are updated,
+    // other IDs (e.g. subtree references) become invalid.
+    void compact(std::vector<Id>& roots, NodeOrder order = NodeOrderDfs);
+
+    // Swap nodes with other manager, frozen and arena flags are kept
+    void swap(NodeManager& other);
+
+private:
+    struct MergeOffsets;
+
+    void check_not_frozen() const;
+    Id merged_id(const MergeOffsets& offsets, const Id& id) const;
+    void update_merged_subtree(const MergeOffsets& offsets, Id& root);
+
+    bool frozen_;
+    bool arena_;
+
     STREE_TMP_MEMBER_DECL(PositionalNode, pos)
     STREE_TMP_MEMBER_DECL(ConstNode, val)
     STREE_FOR_EACH_FUN_ARITY(STREE_TMP_MEMBER_FUN_DECL)
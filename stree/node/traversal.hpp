@@ -0,0 +1,181 @@
+#ifndef STREE_NODE_TRAVERSAL_HPP_
+#define STREE_NODE_TRAVERSAL_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <stree/node/functions.hpp>
+#include <stree/node/impl.hpp>
+#include <stree/types.hpp>
+
+namespace stree {
+
+// Vector with inline storage for first N elements, heap is used only
+// if size exceeds N. Intended for trivial types (stack frames).
+template<typename T, std::size_t N>
+class SmallVector {
+public:
+    SmallVector()
+        : data_(inline_), size_(0), capacity_(N) {}
+
+    SmallVector(const SmallVector&) = delete;
+    SmallVector& operator=(const SmallVector&) = delete;
+
+    void push_back(const T& value) {
+        if (size_ == capacity_)
+            grow();
+        data_[size_++] = value;
+    }
+
+    void pop_back() {
+        assert(size_ > 0);
+        --size_;
+    }
+
+    T& back() {
+        assert(size_ > 0);
+        return data_[size_ - 1];
+    }
+
+    T& operator[](std::size_t n) {
+        assert(n < size_);
+        return data_[n];
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    void clear() {
+        size_ = 0;
+    }
+
+private:
+    void grow() {
+        std::size_t capacity = capacity_ * 2;
+        std::unique_ptr<T[]> heap(new T[capacity]);
+        std::copy(data_, data_ + size_, heap.get());
+        heap_ = std::move(heap);
+        data_ = heap_.get();
+        capacity_ = capacity;
+    }
+
+    T inline_[N];
+    std::unique_ptr<T[]> heap_;
+    T* data_;
+    std::size_t size_;
+    std::size_t capacity_;
+};
+
+namespace id {
+
+// Traversals without recursion, stack is allocated on heap only for
+// trees deeper than TraversalInlineDepth (BFS: wider than
+// TraversalInlineWidth).
+// `IdT' is `Id' or `const Id', NodeManager constness should match.
+// Visitor is called as `visitor(id, depth)' and returns true to stop
+// traversal; traversal functions return true if stopped.
+// Empty nodes are visited as terminals.
+// NOTE: visitor should not allocate nodes, node references
+// may be invalidated.
+
+constexpr std::size_t TraversalInlineDepth = 64;
+constexpr std::size_t TraversalInlineWidth = 128;
+
+// Node before its arguments
+template<typename NodeManagerT, typename IdT, typename Visitor>
+bool preorder(NodeManagerT& nm, IdT& root, Visitor&& visitor) {
+    struct Frame {
+        IdT* id;
+        NodeNum depth;
+    };
+
+    SmallVector<Frame, TraversalInlineDepth * 2> stack;
+    stack.push_back({&root, 0});
+    while (!stack.empty()) {
+        Frame frame = stack.back();
+        stack.pop_back();
+        if (visitor(*frame.id, frame.depth))
+            return true;
+        if (frame.id->empty())
+            continue;
+        // Push arguments in reverse order
+        for (Arity n = frame.id->arity(); n > 0; --n)
+            stack.push_back({&nth_argument(nm, *frame.id, n - 1), frame.depth + 1});
+    }
+    return false;
+}
+
+// Arguments before node, node can be destroyed by visitor
+template<typename NodeManagerT, typename IdT, typename Visitor>
+bool postorder(NodeManagerT& nm, IdT& root, Visitor&& visitor) {
+    struct Frame {
+        IdT* id;
+        Arity next; // next argument to visit
+    };
+
+    SmallVector<Frame, TraversalInlineDepth> stack;
+    stack.push_back({&root, 0});
+    while (!stack.empty()) {
+        Frame& top = stack.back();
+        if (!top.id->empty() && top.next < top.id->arity()) {
+            IdT& argument = nth_argument(nm, *top.id, top.next++);
+            stack.push_back({&argument, 0});
+            continue;
+        }
+        IdT& id = *top.id;
+        NodeNum depth = stack.size() - 1;
+        stack.pop_back();
+        if (visitor(id, depth))
+            return true;
+    }
+    return false;
+}
+
+// Nodes by level, same order as in nth_node.
+// Current and next levels are stored separately, so buffers are
+// allocated on heap only for levels wider than TraversalInlineWidth.
+template<typename NodeManagerT, typename IdT, typename Visitor>
+bool bfs(NodeManagerT& nm, IdT& root, Visitor&& visitor) {
+    using Level = SmallVector<IdT*, TraversalInlineWidth>;
+
+    Level levels[2];
+    Level* current = &levels[0];
+    Level* next = &levels[1];
+    current->push_back(&root);
+    for (NodeNum depth = 0; !current->empty(); ++depth) {
+        for (std::size_t n = 0; n < current->size(); ++n) {
+            IdT& id = *(*current)[n];
+            if (visitor(id, depth))
+                return true;
+            if (id.empty())
+                continue;
+            for (Arity i = 0; i < id.arity(); ++i)
+                next->push_back(&nth_argument(nm, id, i));
+        }
+        current->clear();
+        std::swap(current, next);
+    }
+    return false;
+}
+
+// Callback is called as `callback(id, n, depth)', `n' is node BFS number,
+// returns true to stop
+template<typename Callback>
+void for_each_node(const NodeManager& nm, const Id& id, Callback&& callback) {
+    assert(is_valid_subtree(nm, id) && "Subtree must be valid");
+    NodeNum n = 0;
+    bfs(nm, id, [&](const Id& current, NodeNum depth) {
+        return callback(current, n++, depth);
+    });
+}
+
+}} // namespace id, stree
+
+#endif
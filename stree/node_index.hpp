@@ -0,0 +1,97 @@
+#ifndef STREE_NODE_INDEX_HPP_
+#define STREE_NODE_INDEX_HPP_
+
+#include <cstddef>
+#include <map>
+#include <vector>
+#include <stree/node.hpp>
+#include <stree/search.hpp>
+#include <stree/tree.hpp>
+#include <stree/types.hpp>
+
+namespace stree {
+
+struct NodeIndexEntry {
+    Id* id;
+    NodeNum depth;
+    Arity arity;
+    NodeNum size; // subtree size
+};
+
+// Snapshot of tree nodes in BFS order (same numbering as
+// id::nth_node), built in single pass. Lookups are O(1), so many
+// points can be selected without traversing tree each time.
+// NOTE: index is not updated when tree is modified, it should be
+// rebuilt or invalidated explicitly.
+class NodeIndex {
+public:
+    using EntryList = std::vector<NodeIndexEntry>;
+
+    NodeIndex()
+        : tree_(nullptr) {}
+
+    explicit NodeIndex(TreeBase& tree) {
+        build(tree);
+    }
+
+    void build(TreeBase& tree);
+    void invalidate();
+
+    bool is_valid() const {
+        return tree_ != nullptr;
+    }
+
+    NodeNum size() const {
+        return entries_.size();
+    }
+
+    NodeNum term_num() const {
+        return by_arity_.empty() ? 0 : by_arity_[0].size();
+    }
+
+    NodeNum nonterm_num() const {
+        return nonterms_.size();
+    }
+
+    // Number of nodes matching filter
+    NodeNum count(const NodeFilter& filter) const;
+
+    const NodeIndexEntry& nth(NodeNum n) const;
+    const NodeIndexEntry& nth_terminal(NodeNum n) const;
+    const NodeIndexEntry& nth_nonterminal(NodeNum n) const;
+
+    // NOTE: list of nodes matching several arities is built
+    // on first use
+    const NodeIndexEntry& nth(NodeNum n, const NodeFilter& filter) const;
+
+    // Subtrees of indexed tree
+    Subtree sub(NodeNum n);
+    Subtree sub(NodeNum n, const NodeFilter& filter);
+    Subtree term(NodeNum n);
+    Subtree nonterm(NodeNum n);
+
+    const EntryList& entries() const {
+        return entries_;
+    }
+
+private:
+    using NumList = std::vector<NodeNum>;
+
+    // Numbers of nodes matching filter, null if all nodes match
+    const NumList* nums(const NodeFilter& filter) const;
+
+    const NodeIndexEntry& entry(const NumList* nums, NodeNum n) const;
+
+    Subtree subtree(const NodeIndexEntry& entry);
+
+    TreeBase* tree_;
+    EntryList entries_;
+    NumList nonterms_;
+    std::vector<NumList> by_arity_;
+    mutable std::map<std::vector<Arity>, NumList> by_arities_;
+    NumList empty_;
+};
+
+} // namespace stree
+
+#endif
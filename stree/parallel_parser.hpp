@@ -0,0 +1,54 @@
+#ifndef STREE_PARALLEL_PARSER_HPP_
+#define STREE_PARALLEL_PARSER_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stree/environment.hpp>
+#include <stree/scheduler.hpp>
+#include <stree/tree.hpp>
+
+namespace stree {
+
+// Parses many whitespace-separated trees on scheduler threads.
+// Input is split into chunks of about `chunk_size' bytes at top-level
+// tree boundaries, each chunk is parsed with BulkParser into its own
+// shard, then shards are merged into target environment in input order.
+// Errors are reported with ParserError, positions are counted from
+// start of whole input; first error in input order is reported.
+// NOTE: symbols should not be added to environment while parsing
+class ParallelParser {
+public:
+    static constexpr std::size_t DefaultChunkSize = 1 << 20;
+
+    ParallelParser(
+        Scheduler& scheduler,
+        std::size_t chunk_size = DefaultChunkSize);
+
+    std::vector<Tree> parse(
+        Environment& env,
+        const char* data,
+        std::size_t size);
+
+    std::vector<Tree> parse(Environment& env, const std::string& s) {
+        return parse(env, s.data(), s.size());
+    }
+
+    // Parse memory-mapped file
+    std::vector<Tree> parse_file(Environment& env, const std::string& path);
+
+    std::size_t chunk_size() const {
+        return chunk_size_;
+    }
+
+private:
+    // Chunk start positions, first one is 0
+    std::vector<std::size_t> split(const char* data, std::size_t size) const;
+
+    Scheduler& scheduler_;
+    std::size_t chunk_size_;
+};
+
+} // namespace stree
+
+#endif
@@ -17,12 +17,33 @@ class Parser;
 class ParserError : std::exception {
 public:
     ParserError(const Parser& parser);
+    ParserError(
+        const std::string& message,
+        std::size_t line_num,
+        std::size_t char_num);
 
     virtual const char* what() const noexcept {
         return what_.c_str();
     }
+
+    // Error message without position
+    const std::string& message() const {
+        return message_;
+    }
+
+    std::size_t line_num() const {
+        return line_num_;
+    }
+
+    std::size_t char_num() const {
+        return char_num_;
+    }
+
 private:
     std::string what_;
+    std::string message_;
+    std::size_t line_num_;
+    std::size_t char_num_;
 };
 
 
@@ -93,6 +114,7 @@ public:
 
     std::string state_string() const;
     std::string error_message() const;
+    static std::string error_message(Error error);
 
     std::size_t line_num() const {
         return line_num_;
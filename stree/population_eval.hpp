@@ -0,0 +1,52 @@
+#ifndef STREE_POPULATION_EVAL_HPP_
+#define STREE_POPULATION_EVAL_HPP_
+
+#include <cstddef>
+#include <vector>
+#include <stree/batch_eval.hpp>
+#include <stree/environment.hpp>
+#include <stree/scheduler.hpp>
+#include <stree/tree.hpp>
+
+namespace stree {
+
+// Evaluates trees sharing environment on scheduler threads.
+// Each (tree, block of rows) pair is a separate task, each worker uses
+// its own BatchEval. Node manager is frozen during evaluation.
+// NOTE: functions are called concurrently from multiple threads
+// with same `data' and should be thread-safe.
+class PopulationEval {
+public:
+    PopulationEval(
+        Scheduler& scheduler,
+        std::size_t block_size = BatchEval::DefaultBlockSize);
+
+    // Results for tree N are stored in
+    // out[N * params.row_num(), (N + 1) * params.row_num())
+    void eval(
+        Environment& env,
+        const std::vector<Id>& roots,
+        const ParamMatrix& params,
+        Value* out,
+        DataPtr data = nullptr);
+
+    // All trees should belong to same environment
+    void eval(
+        const std::vector<Tree>& trees,
+        const ParamMatrix& params,
+        Value* out,
+        DataPtr data = nullptr);
+
+    std::size_t block_size() const {
+        return block_size_;
+    }
+
+private:
+    Scheduler& scheduler_;
+    std::size_t block_size_;
+    std::vector<BatchEval> batch_evals_;
+};
+
+} // namespace stree
+
+#endif
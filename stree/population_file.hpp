@@ -0,0 +1,96 @@
+#ifndef STREE_POPULATION_FILE_HPP_
+#define STREE_POPULATION_FILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stree/environment.hpp>
+#include <stree/frozen_tree.hpp>
+#include <stree/tree.hpp>
+
+namespace stree {
+
+/*
+  Binary population file, version 1:
+    header
+    symbol table: name, type, arity, index and
+                  select function arity of each non-constant symbol
+    tree table:   tree_num + 1 node offsets
+    nodes:        FrozenNode records of all trees, preorder
+  Sections are 8-byte aligned. Byte order, value and node size must match
+  the ones of reading program.
+*/
+constexpr std::uint32_t PopulationFileVersion = 1;
+
+// Write trees to binary population file
+void write_population(
+    std::ostream& os,
+    const Environment& env,
+    const std::vector<FrozenTree>& trees);
+
+void write_population(
+    std::ostream& os,
+    const Environment& env,
+    const std::vector<Tree>& trees);
+
+void save_population(
+    const std::string& path,
+    const Environment& env,
+    const std::vector<FrozenTree>& trees);
+
+void save_population(
+    const std::string& path,
+    const Environment& env,
+    const std::vector<Tree>& trees);
+
+// Population file mapped to memory.
+// If symbol indices in file match the ones of `env', trees are used
+// directly from mapped memory, otherwise nodes are copied and updated.
+// Trees keep mapping alive, so they can outlive this object.
+// NOTE: node data is trusted, only file structure is checked
+class MappedPopulation {
+public:
+    MappedPopulation(const Environment& env, const std::string& path);
+
+    FrozenTree operator[](std::size_t n) const;
+
+    std::size_t size() const {
+        return tree_num_;
+    }
+
+    std::size_t node_num() const {
+        return node_num_;
+    }
+
+    // True if trees are read from mapped memory without copying
+    bool is_zero_copy() const {
+        return zero_copy_;
+    }
+
+private:
+    void read_symbols(
+        const char* data,
+        std::size_t size,
+        std::size_t symbol_num);
+    void remap();
+
+    const Environment* env_;
+    std::shared_ptr<const void> mapping_;
+    std::shared_ptr<const void> storage_; // mapping or remapped nodes
+    std::size_t tree_num_;
+    std::size_t node_num_;
+    const std::uint64_t* offsets_;
+    const FrozenNode* nodes_;
+    bool zero_copy_;
+    // File symbol index to environment symbol index
+    std::vector<Position> positions_;
+    std::vector<FunctionIndex> fids_;
+    std::vector<SelectFunctionIndex> sfids_;
+};
+
+} // namespace stree
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef STREE_SCHEDULER_HPP_
+#define STREE_SCHEDULER_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace stree {
+
+// Work-stealing thread pool.
+// Tasks [0, task_num) are split into contiguous ranges, one per worker;
+// worker takes tasks from back of its own queue and steals from
+// front of other queues when its queue is empty.
+class Scheduler {
+public:
+    // Task number and worker number in [0, worker_num())
+    using Task = std::function<void(std::size_t, unsigned)>;
+
+    // Zero means number of hardware threads
+    explicit Scheduler(unsigned worker_num = 0);
+    ~Scheduler();
+
+    Scheduler(const Scheduler& other) = delete;
+    Scheduler& operator=(const Scheduler& other) = delete;
+
+    // Run tasks and wait until they are done, calling thread works
+    // as worker 0. If task throws, remaining tasks are skipped and
+    // first exception is rethrown.
+    void run(std::size_t task_num, const Task& task);
+
+    unsigned worker_num() const {
+        return queues_.size();
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    void thread_main(unsigned worker);
+    void work(unsigned worker);
+    bool pop(unsigned worker, std::size_t& task);
+    bool steal(unsigned worker, std::size_t& task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    const Task* task_;
+    unsigned long generation_;
+    unsigned running_; // threads working on current run
+    bool stop_;
+    std::atomic<bool> cancelled_;
+    std::exception_ptr exception_;
+};
+
+} // namespace stree
+
+#endif
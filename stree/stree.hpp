@@ -2,15 +2,27 @@
 #define STREE_STREE_HPP_
 
 #include <stree/environment.hpp>
+#include <stree/batch_eval.hpp>
+#include <stree/batch_exec.hpp>
 #include <stree/common_region.hpp>
 #include <stree/builder.hpp>
+#include <stree/builtins.hpp>
+#include <stree/bulk_parser.hpp>
 #include <stree/compare.hpp>
+#include <stree/compiled_tree.hpp>
 #include <stree/eval.hpp>
 #include <stree/exec.hpp>
+#include <stree/frozen_tree.hpp>
 #include <stree/macros.hpp>
+#include <stree/mapped_file.hpp>
+#include <stree/parallel_parser.hpp>
 #include <stree/parser.hpp>
+#include <stree/population_eval.hpp>
+#include <stree/population_file.hpp>
+#include <stree/scheduler.hpp>
 #include <stree/string.hpp>
 #include <stree/tree.hpp>
 #include <stree/node.hpp>
+#include <stree/node_index.hpp>
 
 #endif
@@ -2,7 +2,9 @@
 #define STREE_TREE_HPP_
 
 #include <string>
+#include <vector>
 #include <stree/environment/symbol.hpp>
+#include <stree/level_index.hpp>
 #include <stree/macros.hpp>
 #include <stree/types.hpp>
 #include <stree/search.hpp>
@@ -22,15 +24,43 @@ public:
     NodeNum depth;
     NodeNum term_num;
     NodeNum nonterm_num;
+    NodeNum width; // see id::subtree_width
+};
+
+// Static bounds for cost of tree evaluation by Exec,
+// select branches are alternatives
+class TreeCostBound {
+public:
+    TreeCostBound();
+
+    bool is_empty() const;
+    void set_null();
+    void set_zero();
+
+    Cost min;
+    Cost max;
+    NodeNum select_num;
 };
 
 class Environment;
 class Tree;
 class Subtree;
 
+// NOTE: describe() and cost_bound() cache results, calling them
+// concurrently for same tree is not thread-safe.
+// When subtree is replaced or swapped, cached description and cost bound
+// of parent trees are updated from subtree ones (see Subtree::swap),
+// without traversing whole tree.
+// NOTE: caches of tree and its parents are not updated when nodes are
+// modified directly (using root() or id:: functions), reset_cache()
+// should be called for modified subtree afterwards.
 class TreeBase {
 public:
-    TreeBase(Environment* env, TreeBase* parent = nullptr);
+    // `depth': depth of root in parent tree, if known
+    TreeBase(
+        Environment* env,
+        TreeBase* parent = nullptr,
+        NodeNum depth = NoNodeNum);
     virtual ~TreeBase() {}
 
     virtual Id& root() = 0;
@@ -66,6 +96,17 @@ public:
 
     NodeNum width() const;
 
+    const TreeCostBound& cost_bound() const;
+
+    // Indexed mode: sub(), term() and nonterm() find nodes by descent
+    // using level index (see LevelIndex), index is updated when subtree
+    // is replaced
+    void set_indexed(bool indexed);
+
+    bool is_indexed() const {
+        return is_indexed_;
+    }
+
     void reset_cache();
 
     const Environment* env() const {
@@ -77,18 +118,47 @@ public:
     }
 
 protected:
+    // Cached values used to update parent caches
+    struct Aggregates {
+        TreeDescription description;
+        std::vector<NodeNum> level_sizes;
+        TreeCostBound cost_bound;
+        Id root;
+        Id parent; // parent node of root
+    };
+
     Environment* env_;
     TreeBase* parent_;
+    NodeNum depth_;
 
     void check_argument_num(Arity n) const;
     void update_description() const;
-    void update_width() const;
+    void update_cost_bound() const;
     void reset_description();
-    void reset_width();
+    void reset_cost_bound();
+    // Root replaced, update cache of this tree and parents
+    void reset_cache(const Aggregates& old_root, const Aggregates& new_root);
+    // Subtree at `depth' replaced: description is updated if depth
+    // is known, cost bound if there are no selects outside of subtree
+    void replace_subtree(
+        const Aggregates& old_subtree,
+        const Aggregates& new_subtree,
+        NodeNum depth);
+    // Check which caches of parent trees need update
+    void parent_caches(bool& description, bool& cost_bound, bool& index) const;
+    Aggregates aggregates(bool description, bool cost_bound, bool index) const;
+    // Drop removed node entries from level indices of parent trees
+    void compact_index();
+
+    bool is_indexed_;
 
 private:
+    const LevelIndex& index() const;
+
     mutable TreeDescription description_;
-    mutable NodeNum width_;
+    mutable std::vector<NodeNum> level_sizes_; // number of nodes by depth
+    mutable TreeCostBound cost_bound_;
+    mutable LevelIndex index_;
 };
 
 class Subtree : public TreeBase {
@@ -96,8 +166,9 @@ public:
     Subtree(
         Environment* env,
         TreeBase* parent,
-        Id& root)
-        : TreeBase(env, parent),
+        Id& root,
+        NodeNum depth = NoNodeNum)
+        : TreeBase(env, parent, depth),
           root_(root) {}
 
     void destroy();
@@ -113,6 +184,9 @@ public:
         return root_;
     }
 
+    // NOTE: call reset_cache() after modifying nodes directly,
+    // cached description, size, cost bound and level index of parent
+    // trees are not reset otherwise
     virtual Id& root() {
         return root_;
     }
@@ -140,6 +214,9 @@ public:
     Tree(const Tree& other);
     Tree(Tree&& other);
 
+    // Copy tree from other environment with same symbols
+    Tree(Environment* env, const Tree& other);
+
     Tree& operator=(const Tree& other);
     Tree& operator=(Tree&& other);
 
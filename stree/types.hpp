@@ -29,6 +29,63 @@ using Arguments = std::vector<Value>;
 using DataPtr = STREE_DATA_PTR_TYPE;
 using Function = std::function<Value(const Arguments&, DataPtr)>;
 using SelectFunction = std::function<unsigned(const Arguments&, DataPtr)>;
+
+// View of argument values stored elsewhere (see EvalContext in eval.hpp)
+class ArgumentSpan {
+public:
+    using const_iterator = const Value*;
+
+    ArgumentSpan()
+        : data_(nullptr), size_(0) {}
+
+    ArgumentSpan(const Value* data, std::size_t size)
+        : data_(data), size_(size) {}
+
+    explicit ArgumentSpan(const Arguments& arguments)
+        : data_(arguments.data()), size_(arguments.size()) {}
+
+    const Value& operator[](std::size_t n) const {
+        return data_[n];
+    }
+
+    const Value* data() const {
+        return data_;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    const Value& front() const {
+        return data_[0];
+    }
+
+    const Value& back() const {
+        return data_[size_ - 1];
+    }
+
+    const_iterator begin() const {
+        return data_;
+    }
+
+    const_iterator end() const {
+        return data_ + size_;
+    }
+
+private:
+    const Value* data_;
+    std::size_t size_;
+};
+
+using SpanFunction = std::function<Value(ArgumentSpan, DataPtr)>;
+using SpanSelectFunction = std::function<unsigned(ArgumentSpan, DataPtr)>;
+// Batch kernel: out[i] = f(args[0][i], ..., args[arity-1][i]) for i < n
+using BatchFunction = std::function<
+    void(const Value* const* args, Value* out, std::size_t n, DataPtr)>;
 using Cost = float;
 
 
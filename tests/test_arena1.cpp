@@ -0,0 +1,167 @@
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+// (pos x y): return x if positive, evaluate y otherwise
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// Build random tree, grow method, with some constants
+static Id grow(Environment& env, unsigned depth, std::mt19937& prng) {
+    std::uniform_int_distribution<unsigned> coin(0, 3);
+    if (depth == 1 && coin(prng) == 0)
+        return env.make_id(static_cast<Value>(coin(prng)));
+    const SymbolPtrList& symbols = (depth > 1 && coin(prng) > 0)
+        ? env.symbols().nonterminals()
+        : env.symbols().terminals();
+    std::uniform_int_distribution<std::size_t> dist(0, symbols.size() - 1);
+    Id id = env.make_id(symbols[dist(prng)]);
+    for (Arity n = 0; n < id.arity(); ++n)
+        id::nth_argument(env.node_manager(), id, n) = grow(env, depth - 1, prng);
+    return id;
+}
+
+struct NodeNums {
+    std::size_t pool;
+    std::size_t used;
+};
+
+static NodeNums node_nums(const NodeManager& nm) {
+    NodeManagerStats stats(nm);
+    NodeNums nums{0, 0};
+    for (const auto& item : stats.items()) {
+        nums.pool += item.pool_size;
+        nums.used += item.pool_size - item.buffer_size;
+    }
+    return nums;
+}
+
+int main() {
+    // Init environment
+    Environment env;
+    for (const string& name : builtin_names())
+        add_builtin(env, name);
+    env.add_select_function("pos", 2, 1, &::pos);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    // Generational GP with two arenas: generation is built in one arena
+    // from trees in the other one, then previous generation is released
+    std::unique_ptr<Environment> arenas[2] = {env.make_shard(), env.make_shard()};
+    for (auto& arena : arenas)
+        arena->node_manager().set_arena(true);
+
+    const unsigned tree_num = 100;
+    vector<string> first_generation;
+    NodeNums arena_nums[2] = {{0, 0}, {0, 0}};
+    vector<Tree> population;
+    for (unsigned generation = 0; generation < 8; ++generation) {
+        Environment& arena = *arenas[generation % 2];
+        vector<Tree> next;
+        std::mt19937 prng(1);
+        for (unsigned n = 0; n < tree_num; ++n) {
+            Tree tree(&arena, grow(arena, 5, prng));
+            // replace subtree, old nodes are not freed
+            // NOTE: make replacement first, allocation invalidates
+            // subtree reference with packed nodes
+            Tree branch(&arena, grow(arena, 3, prng));
+            if (tree.describe().size > 1)
+                tree.sub(1).replace(branch);
+            // copy subtree of parent from previous generation
+            if (!population.empty()
+                && tree.arity() > 1
+                && population[n].describe().size > 1)
+            {
+                Tree parent_branch(&arena, population[n].sub(1).copy());
+                tree.sub(2).replace(parent_branch);
+            }
+            next.push_back(std::move(tree));
+        }
+        for (const Tree& tree : next) {
+            if (!tree.is_valid()) {
+                cerr << "Invalid tree" << endl;
+                return -1;
+            }
+            eval(tree, Params({1, -1}));
+            if (generation == 0)
+                first_generation.push_back(to_string(tree));
+        }
+
+        // Discard previous generation
+        population = std::move(next);
+        if (generation > 0) {
+            NodeManager& nm = arenas[(generation + 1) % 2]->node_manager();
+            nm.release();
+            if (node_nums(nm).used != 0) {
+                cerr << "Nodes not released" << endl;
+                return -1;
+            }
+        }
+
+        NodeNums nums = node_nums(arena.node_manager());
+        cout << "Generation " << generation << ": "
+             << nums.used << " nodes used, " << nums.pool << " in pools" << endl;
+        // Starting from generation 2 parents are same, so are numbers
+        // of used nodes; pools stop growing once retired nodes are reused
+        NodeNums& prev_nums = arena_nums[generation % 2];
+        if ((generation > 3 && nums.used != prev_nums.used)
+            || (generation > 5 && nums.pool != prev_nums.pool))
+        {
+            cerr << "Node numbers don't match, expected "
+                 << prev_nums.used << " used, " << prev_nums.pool
+                 << " in pools" << endl;
+            return -1;
+        }
+        prev_nums = nums;
+    }
+
+    // Nodes are not freed in arena mode
+    {
+        NodeManager& nm = population.front().env()->node_manager();
+        std::size_t used = node_nums(nm).used;
+        population.pop_back();
+        if (node_nums(nm).used != used) {
+            cerr << "Nodes were freed in arena mode" << endl;
+            return -1;
+        }
+    }
+    population.clear();
+
+    // Same trees after reusing retired nodes
+    {
+        Environment& arena = *arenas[0];
+        arena.node_manager().release();
+        std::mt19937 prng(1);
+        Tree tree(&arena, grow(arena, 5, prng));
+        Tree branch(&arena, grow(arena, 3, prng));
+        if (tree.describe().size > 1)
+            tree.sub(1).replace(branch);
+        CHECK_TREE_STR(tree, first_generation[0]);
+    }
+
+    // Per-node freeing in normal mode
+    NodeManager& nm = env.node_manager();
+    {
+        std::mt19937 prng(2);
+        Tree tree(&env, grow(env, 5, prng));
+        std::size_t used = node_nums(nm).used;
+        Tree(&env, grow(env, 5, prng));
+        if (node_nums(nm).used != used) {
+            cerr << "Nodes not freed in normal mode" << endl;
+            return -1;
+        }
+    }
+    if (node_nums(nm).used != 0) {
+        cerr << "Nodes not freed in normal mode" << endl;
+        return -1;
+    }
+    return 0;
+}
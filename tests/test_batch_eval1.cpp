@@ -0,0 +1,97 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+static Value plus(const Arguments& args, DataPtr) {
+    return args[0] + args[1];
+}
+
+static Value minus(const Arguments& args, DataPtr) {
+    return args[0] - args[1];
+}
+
+static Value mult(const Arguments& args, DataPtr) {
+    return args[0] * args[1];
+}
+
+static Value neg(const Arguments& args, DataPtr) {
+    return -args[0];
+}
+
+// (pos x y): return x if positive, evaluate y otherwise
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// (max a b): select larger argument
+static unsigned max(const Arguments& args, DataPtr) {
+    return (args[0] < args[1]) ? 1 : 0;
+}
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("+", 2, &::plus);
+    env.add_function("-", 2, &::minus);
+    env.add_function("*", 2, &::mult);
+    env.add_function("neg", 1, &::neg);
+    env.add_select_function("pos", 2, 1, &::pos);
+    env.add_select_function("max", 2, 2, &::max);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+    env.add_positional("z", 2);
+
+    vector<string> tss{
+        "x",
+        "1.5",
+        "(+ x y)",
+        "(- (* x x) (* 2 z))",
+        "(pos (- x y) (neg z))",
+        "(max (+ x 1) (* y y))",
+        "(pos x (pos y (pos z (+ x (* y z)))))",
+        "(* (pos (- y z) (max x (neg y))) (pos (neg x) (max (pos z y) 0.5)))"
+    };
+
+    // Random fitness cases
+    const std::size_t row_num = 1000;
+    std::mt19937 prng(1);
+    std::uniform_real_distribution<float> dist(-10, 10);
+    std::vector<Params> rows(row_num);
+    for (Params& params : rows)
+        params = {dist(prng), dist(prng), dist(prng)};
+    ParamMatrix matrix(rows);
+
+    // Use small block size to check incomplete blocks
+    BatchEval batch_eval(64);
+
+    Parser p(&env);
+    for (const string& ts : tss) {
+        PARSE(p, ts);
+        Tree tree(&env, p.move_result());
+        cout << tree << endl;
+
+        vector<Value> results(row_num);
+        batch_eval.eval(env, tree.root(), matrix, results.data());
+
+        vector<Value> results_default(row_num);
+        eval_batch(tree, matrix, results_default.data());
+
+        for (std::size_t n = 0; n < row_num; ++n) {
+            Value answer = eval(tree, rows[n]);
+            if (results[n] != answer || results_default[n] != answer) {
+                cerr << "Row " << n << ": result " << results[n]
+                     << " (default block size: " << results_default[n] << ")"
+                     << ", answer: " << answer << endl;
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
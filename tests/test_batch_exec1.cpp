@@ -0,0 +1,184 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+// Counts calls in data
+static Value plus(const Arguments& args, DataPtr data) {
+    if (data)
+        ++*static_cast<unsigned*>(data);
+    return args[0] + args[1];
+}
+
+static Value neg(ArgumentSpan args, DataPtr) {
+    return -args[0];
+}
+
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+#define CHECK_EQ(_value, _expected)                                     \
+    if ((_value) != (_expected)) {                                      \
+        cerr << #_value << " = " << (_value)                            \
+             << ", expected " << (_expected) << endl;                   \
+        return -1;                                                      \
+    }
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("+", 2, &::plus, 1);
+    env.add_span_function("neg", 1, &::neg);
+    env.add_select_function("if", 2, 1, &::pos, 2);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    Parser p(&env);
+    PARSE(p,
+          "(+ (neg (+ x (if (+ x y) (neg (+ 1 y)))))"
+          "   (if (neg x) (+ (neg y) (if y (neg (neg x))))))");
+    Tree tree(&env, p.move_result());
+
+    // Agents take different branches
+    vector<Params> params;
+    for (int x = -2; x <= 2; ++x)
+        for (int y = -2; y <= 2; ++y)
+            params.push_back(Params{Value(x), Value(y)});
+    const std::size_t agent_num = params.size();
+
+    // Each step matches Exec step for every agent
+    for (Exec::Flag flags : {
+            Exec::FlagStopOnFunctions,
+            Exec::FlagStopOnSelects,
+            Exec::FlagStopIfCostNotZero,
+            Exec::FlagStopOnFinished})
+    {
+        vector<unsigned> counts(agent_num, 0);
+        vector<unsigned> batch_counts(agent_num, 0);
+        vector<Exec> execs;
+        BatchExec batch(tree, flags);
+        for (std::size_t n = 0; n < agent_num; ++n) {
+            execs.emplace_back(tree, flags);
+            execs.back().init(&params[n], &counts[n]);
+            CHECK_EQ(batch.add_agent(&params[n], &batch_counts[n]), n);
+        }
+        CHECK_EQ(batch.agent_num(), agent_num);
+
+        for (unsigned step = 0; step < 20; ++step) {
+            batch.step();
+            for (std::size_t n = 0; n < agent_num; ++n) {
+                Exec& exec = execs[n];
+                exec.step();
+                CHECK_EQ(batch.is_finished(n), exec.is_finished());
+                CHECK_EQ(batch.cost_used(n), exec.cost_used());
+                if (exec.is_finished())
+                    CHECK_EQ(batch.result(n), exec.result());
+                CHECK_EQ(batch_counts[n], counts[n]);
+            }
+        }
+    }
+
+    // Agent kernel is called once for group of agents
+    {
+        unsigned call_num = 0;
+        unsigned agent_call_num = 0;
+        bool data_ok = true;
+        vector<unsigned> ids(agent_num);
+        BatchExec batch(tree, Exec::FlagStopOnFinished);
+        batch.set_agent_function(
+            "+",
+            [&](const Value* const* args, Value* out, std::size_t size,
+                const DataPtr* data)
+            {
+                ++call_num;
+                agent_call_num += size;
+                for (std::size_t i = 0; i < size; ++i) {
+                    out[i] = args[0][i] + args[1][i];
+                    unsigned id = *static_cast<unsigned*>(data[i]);
+                    data_ok = data_ok && id < agent_num && &ids[id] == data[i];
+                }
+            });
+        for (std::size_t n = 0; n < agent_num; ++n) {
+            ids[n] = n;
+            batch.add_agent(&params[n], &ids[n]);
+        }
+        batch.run();
+        CHECK_EQ(batch.is_finished(), true);
+        for (std::size_t n = 0; n < agent_num; ++n)
+            CHECK_EQ(batch.result(n), eval(tree, params[n]));
+        CHECK_EQ(data_ok, true);
+        cout << "Nodes: " << batch.node_eval_num()
+             << ", groups: " << batch.group_eval_num()
+             << ", kernel calls: " << call_num << endl;
+        if (!(call_num < agent_call_num)
+            || !(batch.group_eval_num() < batch.node_eval_num() / 4))
+        {
+            cerr << "Agents are not grouped" << endl;
+            return -1;
+        }
+    }
+
+    // Cost limit
+    {
+        BatchExec batch(tree, Exec::FlagStopOnFinished);
+        batch.set_cost_limit(3);
+        for (std::size_t n = 0; n < agent_num; ++n)
+            batch.add_agent(&params[n]);
+        try {
+            batch.run();
+            cerr << "Cost limit not exceeded" << endl;
+            return -1;
+        } catch (const ExecCostLimitExceeded&) {}
+    }
+
+    // Cost limit, no exception: same as Exec for each agent,
+    // agents within limit are finished
+    {
+        const Exec::Flag flags = Exec::FlagStopOnFinished | Exec::FlagNoThrow;
+        const Cost limit =
+            (tree.cost_bound().min + tree.cost_bound().max) / 2;
+        BatchExec batch(tree, flags);
+        batch.set_cost_limit(limit);
+        for (std::size_t n = 0; n < agent_num; ++n)
+            batch.add_agent(&params[n]);
+        CHECK_EQ(batch.run(), Exec::StatusCostLimitExceeded);
+        unsigned exceeded_num = 0;
+        for (std::size_t n = 0; n < agent_num; ++n) {
+            Exec exec(tree, flags);
+            exec.set_cost_limit(limit);
+            exec.init(&params[n]);
+            Exec::Status status = exec.run();
+            CHECK_EQ(batch.status(n), status);
+            CHECK_EQ(batch.is_finished(n), exec.is_finished());
+            CHECK_EQ(batch.cost_used(n), exec.cost_used());
+            if (status == Exec::StatusOk) {
+                CHECK_EQ(batch.result(n), exec.result());
+            } else {
+                ++exceeded_num;
+            }
+        }
+        if (exceeded_num == 0 || exceeded_num == agent_num) {
+            cerr << "Cost limit exceeded by " << exceeded_num
+                 << " agents" << endl;
+            return -1;
+        }
+        // Agents are stopped again
+        CHECK_EQ(batch.step(), Exec::StatusCostLimitExceeded);
+    }
+
+    // Unknown function
+    {
+        BatchExec batch(tree);
+        try {
+            batch.set_agent_function("if", nullptr);
+            cerr << "Agent function set for select" << endl;
+            return -1;
+        } catch (const std::invalid_argument&) {}
+    }
+    return 0;
+}
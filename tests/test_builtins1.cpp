@@ -0,0 +1,89 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+// Function without batch kernel
+static Value neg(const Arguments& args, DataPtr) {
+    return -args[0];
+}
+
+int main() {
+    // Init environment
+    Environment env;
+    for (const string& name : builtin_names())
+        add_builtin(env, name);
+    add_builtin(env, "div", "%");
+    env.add_function("neg", 1, &::neg);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    // Check protected division
+    {
+        Parser p(&env);
+        PARSE(p, "(div x y)");
+        Tree tree(&env, p.move_result());
+        CHECK_EVAL(tree, Params({3, 0}), 1, nullptr);
+        CHECK_EVAL(tree, Params({3, 2}), 1.5, nullptr);
+    }
+
+    vector<string> tss{
+        "(+ x y)",
+        "(- x y)",
+        "(* x y)",
+        "(% x y)",
+        "(min x y)",
+        "(max x y)",
+        "(< x y)",
+        "(<= x y)",
+        "(> x y)",
+        "(>= x y)",
+        "(== x y)",
+        "(!= x y)",
+        "(+ (* x (neg y)) (% (max x 1) (min y 0)))",
+        "(* (< x y) (- (neg x) (>= y (== x 0))))"
+    };
+
+    // Fitness cases, with some equal and zero values
+    const std::size_t row_num = 300;
+    std::mt19937 prng(1);
+    std::uniform_int_distribution<int> dist(-3, 3);
+    std::vector<Params> rows(row_num);
+    for (Params& params : rows)
+        params = {
+            static_cast<Value>(dist(prng)),
+            static_cast<Value>(dist(prng)) / 2};
+    ParamMatrix matrix(rows);
+
+    Parser p(&env);
+    for (const string& ts : tss) {
+        PARSE(p, ts);
+        Tree tree(&env, p.move_result());
+        cout << tree << endl;
+
+        vector<Value> results(row_num);
+        eval_batch(tree, matrix, results.data());
+        for (std::size_t n = 0; n < row_num; ++n) {
+            Value answer = eval(tree, rows[n]);
+            if (results[n] != answer) {
+                cerr << "Row " << n << ": result " << results[n]
+                     << ", answer: " << answer << endl;
+                return -1;
+            }
+        }
+    }
+
+    // Unknown built-in
+    try {
+        add_builtin(env, "unknown");
+        cerr << "Exception expected" << endl;
+        return -2;
+    } catch (const std::invalid_argument&) {}
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+#include "node_manager_macros.hpp"
+
+DEFUN_EMPTY(func);
+DEFUN_EMPTY(inc);
+
+static unsigned cond(const stree::Arguments&, stree::DataPtr) {
+    return 0;
+}
+
+using namespace std;
+using namespace stree;
+
+// Parse with bulk parser, result should match Parser
+static bool check_same(Environment& env, const string& input) {
+    vector<string> answers;
+    {
+        Parser p(&env);
+        std::size_t pos = 0;
+        while (input.find_first_not_of(" \t\r\n", pos) != string::npos) {
+            pos += p.parse(input.substr(pos)) + 1;
+            if (!p.is_done()) {
+                cerr << "Parser error: " << p.error_message() << endl;
+                return false;
+            }
+            answers.push_back(to_string(Tree(&env, p.move_result())));
+        }
+    }
+    BulkParser bp(&env);
+    vector<Tree> trees = bp.make_trees(bp.parse(input));
+    if (trees.size() != answers.size()) {
+        cerr << "Expected " << answers.size() << " trees, got "
+             << trees.size() << endl;
+        return false;
+    }
+    for (std::size_t n = 0; n < trees.size(); ++n)
+        CHECK_TREE_STR(trees[n], answers[n]);
+    return true;
+}
+
+struct ErrorCase {
+    string input;
+    Parser::Error error;
+    std::size_t line_num;
+    std::size_t char_num;
+};
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("+", 2, &func);
+    env.add_function("-", 2, &func);
+    env.add_function("neg", 1, &func);
+    env.add_function("inc", 0, &inc);
+    env.add_select_function("if", 2, 1, &cond);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+    env.add_constant("pi", 3.14);
+    NodeManager& nm = env.node_manager();
+    NodeManagerStats nms;
+
+    if (!check_same(env, "x")
+        || !check_same(env, "  1.5\n")
+        || !check_same(env, "(+ x y)\n(- 1 2.5)\n\n(neg (inc))\n")
+        || !check_same(env, "x y pi 12 (if (+ x 1) (neg y))")
+        || !check_same(env, "(- 0.125 1234567890.123456789)")
+        || !check_same(env, "(+ (+ x\ty)\n   (if (- x 1) (inc)))")
+        || !check_same(env, ""))
+        return -1;
+
+    // Pools are reserved before making nodes
+    {
+        string input;
+        for (unsigned n = 0; n < 100; ++n)
+            input += "(+ x (neg 1))\n";
+        BulkParser bp(&env);
+        vector<Id> roots = bp.parse(input);
+        nms.update(nm);
+        CHECK_STATS(nms, TypeFunction, 2, 100, 0);
+        CHECK_STATS(nms, TypeFunction, 1, 100, 0);
+        CHECK_STATS(nms, TypeConst, 0, 100, 0);
+        vector<Tree> trees = bp.make_trees(std::move(roots));
+        CHECK_TREE_STR(trees.back(), "(+ x (neg 1))");
+    }
+
+    // Errors, no nodes are left
+    vector<ErrorCase> errors{
+        {"(+ x y", Parser::ErrorUnexpectedEnd, 1, 7},
+        {"(+ x y)\n(", Parser::ErrorUnexpectedEnd, 2, 2},
+        {"x\n  (+ x z)", Parser::ErrorSymbolNotFound, 2, 8},
+        {"(+ x y))", Parser::ErrorUnexpectedRightParen, 1, 8},
+        {"(x)", Parser::ErrorSymbolUnexpectedVariable, 1, 2},
+        {"neg", Parser::ErrorSymbolUnexpectedCallable, 1, 1},
+        {"(+ x y 1)", Parser::ErrorTooManyArguments, 1, 8},
+        {"(+ x)", Parser::ErrorNotEnoughArguments, 1, 5},
+        {"(1)", Parser::ErrorUnexpectedNumber, 1, 2},
+        {"(+ 1a x)", Parser::ErrorUnexpectedNonNumber, 1, 5},
+        {"(+ 1.2.3 x)", Parser::ErrorNumberUnexpectedDot, 1, 7},
+        {"(+ x Y)", Parser::ErrorInvalidChar, 1, 6},
+        {"(+ x(neg y))", Parser::ErrorUnexpectedLeftParen, 1, 5},
+    };
+    for (const ErrorCase& error : errors) {
+        BulkParser bp(&env);
+        try {
+            bp.parse(error.input);
+            cerr << "No error for `" << error.input << "'" << endl;
+            return -1;
+        } catch (const ParserError& e) {
+            cout << e.what() << endl;
+            string message = Parser::error_message(error.error);
+            if (string(e.what()).find(message) == string::npos
+                || e.line_num() != error.line_num
+                || e.char_num() != error.char_num)
+            {
+                cerr << "Expected `" << message << "' at line "
+                     << error.line_num << " char " << error.char_num << endl;
+                return -1;
+            }
+        }
+    }
+    nms.update(nm);
+    for (const auto& item : nms.items()) {
+        if (item.pool_size != item.buffer_size) {
+            cerr << "Nodes left after error" << endl;
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+#include "node_manager_macros.hpp"
+
+DEFUN_EMPTY(func);
+
+using namespace std;
+using namespace stree;
+
+static const vector<string> Strings = {
+    "(+ (+ (+ a a) b) (+ b a))",
+    "(+ a (+ 1 (+ a b)))",
+    "b"
+};
+
+static void fill(Environment& env, vector<Tree>& trees) {
+    // Interleave trees with garbage to fragment pools
+    for (const string& s : Strings) {
+        Parser gp(&env);
+        PARSE(gp, "(+ (+ a a) (+ 2 b))");
+        Tree garbage(&env, gp.move_result());
+        Parser p(&env);
+        PARSE(p, s);
+        trees.emplace_back(&env, p.move_result());
+    }
+}
+
+#ifdef PACKED_NODE
+static Id::Index arg_index(const NodeManager& nm, const Id& id, Arity n) {
+    return id::nth_argument(nm, id, n).index();
+}
+#endif
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("+", 2, &func);
+    env.add_positional("a", 0);
+    env.add_positional("b", 1);
+    NodeManager& nm = env.node_manager();
+    NodeManagerStats nms;
+
+    for (NodeOrder order : {NodeOrderDfs, NodeOrderBfs}) {
+        vector<Tree> trees;
+        fill(env, trees);
+        // Build level index of indexed trees
+        trees[0].set_indexed(true);
+        trees[1].set_indexed(true);
+        trees[0].sub(3);
+        trees[1].sub(3);
+
+        env.compact(trees, order);
+        for (unsigned n = 0; n < trees.size(); ++n)
+            CHECK_TREE_STR(trees[n], Strings[n]);
+        // Index is rebuilt for new node IDs
+        for (unsigned n = 0; n < 2; ++n) {
+            Tree& tree = trees[n];
+            for (NodeNum k = 0; k < tree.describe().size; ++k) {
+                if (!(tree.sub(k).root() == id::nth_node(nm, tree.root(), k))) {
+                    cerr << "Wrong node " << k << " in indexed tree "
+                         << n << " after compaction" << endl;
+                    return -1;
+                }
+            }
+        }
+        // No free nodes left
+        nms.update(nm);
+        CHECK_STATS(nms, TypeFunction, 2, 7, 0);
+        CHECK_STATS(nms, TypePositional, 0, 9, 0);
+        CHECK_STATS(nms, TypeConst, 0, 1, 0);
+
+#ifdef PACKED_NODE
+        // Nodes of each tree are contiguous and ordered
+        const Id& root = trees[0].root();
+        const Id& left = id::nth_argument(nm, root, 0);
+        const Id::Index expected[] = {0, 1, 2, 3};
+        const Id::Index indices[] = {
+            root.index(),
+            left.index(),
+            (order == NodeOrderDfs)
+                ? arg_index(nm, left, 0)
+                : arg_index(nm, root, 1),
+            (order == NodeOrderDfs)
+                ? arg_index(nm, root, 1)
+                : arg_index(nm, left, 0)
+        };
+        for (unsigned n = 0; n < 4; ++n) {
+            if (indices[n] != expected[n]) {
+                cerr << "Unexpected node index " << indices[n]
+                     << ", expected " << expected[n] << endl;
+                return -1;
+            }
+        }
+        if (trees[1].root().index() != 4) {
+            cerr << "Second tree is not next to the first one" << endl;
+            return -1;
+        }
+#endif
+
+        // Manager is usable after compaction
+        trees.pop_back();
+        nms.update(nm);
+        CHECK_STATS(nms, TypePositional, 0, 9, 1);
+        Tree tree(&env, env.make_id("a"));
+        nms.update(nm);
+        CHECK_STATS(nms, TypePositional, 0, 9, 0);
+        trees.clear();
+    }
+
+    // Frozen manager cannot be compacted
+    nm.freeze();
+    try {
+        vector<Tree> trees;
+        env.compact(trees);
+        cerr << "Frozen manager was compacted" << endl;
+        return -1;
+    } catch (const std::logic_error&) {}
+    nm.unfreeze();
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+static Value plus(const Arguments& args, DataPtr) {
+    return args[0] + args[1];
+}
+
+static Value minus(const Arguments& args, DataPtr) {
+    return args[0] - args[1];
+}
+
+static Value mult(const Arguments& args, DataPtr) {
+    return args[0] * args[1];
+}
+
+static Value inc(const Arguments&, DataPtr data) {
+    return ++(*static_cast<unsigned*>(data));
+}
+
+// (pos x y): return x if positive, evaluate y otherwise
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// (flip x y): evaluate x or y depending on side effect counter
+static unsigned flip(const Arguments&, DataPtr data) {
+    return *static_cast<unsigned*>(data) % 2;
+}
+
+// (max a b): select larger argument
+static unsigned max(const Arguments& args, DataPtr) {
+    return (args[0] < args[1]) ? 1 : 0;
+}
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("+", 2, &::plus);
+    env.add_function("-", 2, &::minus);
+    env.add_function("*", 2, &::mult);
+    env.add_function("inc", 0, &::inc);
+    env.add_select_function("pos", 2, 1, &::pos);
+    env.add_select_function("flip", 2, 0, &::flip);
+    env.add_select_function("max", 2, 2, &::max);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    vector<string> tss{
+        "x",
+        "2.5",
+        "(+ x y)",
+        "(- (* x x) (* 2 y))",
+        "(pos (- x y) (- x (inc)))",
+        "(max (+ x 1) (* y y))",
+        "(flip (+ (inc) (max x (inc))) (pos y (inc)))",
+        "(+ (pos x (* y (inc))) (flip (pos (inc) x) (max (inc) (flip 3 y))))"
+    };
+    vector<Params> rows{
+        {0, 0}, {1, 2}, {2, 1}, {-3, 4}, {5, -1.5}, {-2, -2}
+    };
+
+    Parser p(&env);
+    for (const string& ts : tss) {
+        PARSE(p, ts);
+        Tree tree(&env, p.move_result());
+        CompiledTree compiled(tree);
+        cout << tree << ", " << compiled.size() << " instructions" << endl;
+        for (const Params& params : rows) {
+            unsigned data1 = 0;
+            unsigned data2 = 0;
+            Value value1 = eval(tree, params, &data1);
+            Value value2 = compiled.eval(params, &data2);
+            cout << "x: " << params[0] << ", y: " << params[1]
+                 << ", result: " << value2 << ", answer: " << value1 << endl;
+            if (value1 != value2) {
+                cerr << "Compiled tree result does not match" << endl;
+                return -1;
+            }
+            if (data1 != data2) {
+                cerr << "Side effects do not match: " << data2
+                     << ", answer: " << data1 << endl;
+                return -2;
+            }
+        }
+    }
+
+    return 0;
+}
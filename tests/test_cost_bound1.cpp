@@ -0,0 +1,157 @@
+#include <iostream>
+#include <string>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+static Value plus(const Arguments& args, DataPtr) {
+    return args[0] + args[1];
+}
+
+static Value neg(ArgumentSpan args, DataPtr) {
+    return -args[0];
+}
+
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+static unsigned second(const Arguments&, DataPtr) {
+    return 1;
+}
+
+static Tree parse(Environment& env, const string& source) {
+    Parser p(&env);
+    p.parse(source);
+    if (!p.is_done()) {
+        cerr << "Failed to parse " << source << endl;
+        return Tree(&env);
+    }
+    return Tree(&env, p.move_result());
+}
+
+static Cost exec_cost(const Tree& tree, Params& params) {
+    Exec exec(tree, Exec::FlagStopOnFinished);
+    exec.init(&params);
+    exec.run();
+    return exec.cost_used();
+}
+
+#define CHECK_EQ(_value, _expected)                                     \
+    if ((_value) != (_expected)) {                                      \
+        cerr << #_value << " = " << (_value)                            \
+             << ", expected " << (_expected) << endl;                   \
+        return -1;                                                      \
+    }
+
+#define CHECK_BOUND(_bound, _min, _max, _select_num)                    \
+    CHECK_EQ((_bound).min, _min);                                       \
+    CHECK_EQ((_bound).max, _max);                                       \
+    CHECK_EQ((_bound).select_num, _select_num);
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("+", 2, &::plus, 1);
+    env.add_span_function("neg", 1, &::neg, 2);
+    env.add_select_function("if", 2, 1, &::pos, 4);
+    env.add_select_function("alt", 2, 0, &::second, 8);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+    env.symbols().by_name("y")->set_cost(16);
+
+    // No selects, cost is exact
+    {
+        Tree tree = parse(env, "(+ (neg x) (+ y 1))");
+        CHECK_BOUND(tree.cost_bound(), 20, 20, 0u);
+        Params params{1, 2};
+        CHECK_EQ(exec_cost(tree, params), 20);
+    }
+
+    // Selects
+    {
+        // if: x evaluated, then either (neg 1) or nothing
+        Tree tree = parse(env, "(if x (neg 1))");
+        CHECK_BOUND(tree.cost_bound(), 4, 6, 1u);
+        // alt: either y or (neg y)
+        tree = parse(env, "(alt y (neg y))");
+        CHECK_BOUND(tree.cost_bound(), 24, 26, 1u);
+        // Nested
+        tree = parse(env, "(+ (neg (if (alt x y) (neg x))) (if y x))");
+        CHECK_BOUND(tree.cost_bound(), 35, 53, 3u);
+    }
+
+    // Exec cost is within bounds
+    {
+        Tree tree = parse(
+            env,
+            "(+ (neg (+ x (if (+ x y) (neg (+ 1 y)))))"
+            "   (if (neg x) (+ (neg y) (if y (neg (neg x))))))");
+        const TreeCostBound& bound = tree.cost_bound();
+        Cost min = bound.max;
+        Cost max = bound.min;
+        for (int x = -2; x <= 2; ++x) {
+            for (int y = -2; y <= 2; ++y) {
+                Params params{Value(x), Value(y)};
+                Cost cost = exec_cost(tree, params);
+                if (cost < bound.min || cost > bound.max) {
+                    cerr << "Cost " << cost << " is out of bounds" << endl;
+                    return -1;
+                }
+                min = std::min(min, cost);
+                max = std::max(max, cost);
+            }
+        }
+        cout << "Bound: " << bound.min << " - " << bound.max
+             << ", exec: " << min << " - " << max << endl;
+        CHECK_EQ(min, bound.min);
+        CHECK_EQ(max, bound.max);
+    }
+
+    // Incremental update, cached bound is same as computed
+    {
+        Tree tree = parse(env, "(+ (neg x) (+ y (+ 1 x)))");
+        CHECK_BOUND(tree.cost_bound(), 21, 21, 0u);
+        // Select added
+        tree.sub(4).replace(parse(env, "(if y (neg x))"));
+        CHECK_BOUND(tree.cost_bound(), 25, 27, 1u);
+        // Select replaced, no selects outside
+        tree.sub(4).replace(parse(env, "(neg y)"));
+        CHECK_BOUND(tree.cost_bound(), 23, 23, 0u);
+        // Replaced under select
+        tree.sub(1).replace(parse(env, "(if y (neg x))"));
+        CHECK_BOUND(tree.cost_bound(), 41, 43, 1u);
+        tree.sub(4).replace(parse(env, "(neg (neg y))"));
+        CHECK_BOUND(tree.cost_bound(), 41, 61, 1u);
+        CHECK_BOUND(tree.sub(1).cost_bound(), 20, 40, 1u);
+        // Swap within tree
+        tree.sub(1).swap(tree.sub(6));
+        CHECK_EQ(
+            to_string(tree),
+            "(+ (+ 1 x) (+ (neg y) (if y (neg (neg y)))))");
+        CHECK_BOUND(tree.cost_bound(), 41, 61, 1u);
+        // Root symbol replaced
+        tree.sub(2).set("if");
+        CHECK_BOUND(tree.cost_bound(), 24, 64, 2u);
+        // Copy
+        Tree copy = parse(env, "x");
+        copy.cost_bound();
+        copy = tree;
+        CHECK_BOUND(copy.cost_bound(), 24, 64, 2u);
+    }
+
+    // Deep tree
+    {
+        Id root = env.make_id(env.symbols().by_name("x"));
+        for (unsigned n = 0; n < 100000; ++n) {
+            Id id = env.make_id(env.symbols().by_name("neg"));
+            id::nth_argument(env.node_manager(), id, 0) = root;
+            root = id;
+        }
+        Tree deep(&env, root);
+        CHECK_BOUND(deep.cost_bound(), 200000, 200000, 0u);
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+// Count heap allocations
+static std::size_t alloc_num = 0;
+
+void* operator new(std::size_t size) {
+    ++alloc_num;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+static Value plus(ArgumentSpan args, DataPtr) {
+    return args[0] + args[1];
+}
+
+static Value mult(const Arguments& args, DataPtr) {
+    return args[0] * args[1];
+}
+
+static Value sum(ArgumentSpan args, DataPtr) {
+    Value result{};
+    for (Value value : args)
+        result += value;
+    return result;
+}
+
+static Value inc(ArgumentSpan, DataPtr data) {
+    return ++(*static_cast<unsigned*>(data));
+}
+
+// (pos x y): return x if positive, evaluate y otherwise
+static unsigned pos(ArgumentSpan args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// (max a b): select larger argument
+static unsigned max(const Arguments& args, DataPtr) {
+    return (args[0] < args[1]) ? 1 : 0;
+}
+
+int main() {
+    // Init environment, mixing span and `Arguments' functions
+    Environment env;
+    env.add_span_function("+", 2, &::plus);
+    env.add_function("*", 2, &::mult);
+    env.add_span_function("sum", 3, &::sum);
+    env.add_span_function("inc", 0, &::inc);
+    env.add_span_select_function("pos", 2, 1, &::pos);
+    env.add_select_function("max", 2, 2, &::max);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    // Adapter for span function
+    {
+        Arguments args{1, 2};
+        FunctionIndex fid = env.symbols().by_name("+")->fid();
+        if (!env.has_span_function(fid) || env.function(fid)(args, nullptr) != 3) {
+            cerr << "Span function adapter failed" << endl;
+            return -1;
+        }
+        fid = env.symbols().by_name("*")->fid();
+        if (env.has_span_function(fid)) {
+            cerr << "Unexpected span function" << endl;
+            return -1;
+        }
+    }
+
+    vector<string> tss{
+        "x",
+        "(+ x y)",
+        "(sum (* x x) (+ x (inc)) (pos (+ x y) (* y (inc))))",
+        "(max (sum x y (inc)) (* (pos y x) (+ x 1)))",
+        "(pos (max (+ x (inc)) y) (sum (pos x (* y y)) (inc) 2))"
+    };
+
+    vector<Params> rows{
+        {1, 2}, {-1, 2}, {2, -3}, {0, 0}, {-2, -1}, {0.5, 4}
+    };
+
+    Parser p(&env);
+    EvalContext context;
+    for (const string& ts : tss) {
+        PARSE(p, ts);
+        Tree tree(&env, p.move_result());
+        cout << tree << endl;
+
+        CompiledTree compiled(tree);
+        for (const Params& params : rows) {
+            // Same results and side effects with and without context
+            unsigned counter = 0;
+            Value answer = eval(tree, params, &counter);
+            unsigned counter_answer = counter;
+            counter = 0;
+            Value result = eval(context, tree, params, &counter);
+            if (result != answer || counter != counter_answer) {
+                cerr << "Result: " << result << ", answer: " << answer << endl;
+                return -1;
+            }
+            counter = 0;
+            Value compiled_result = compiled.eval(params, &counter);
+            if (compiled_result != answer || counter != counter_answer) {
+                cerr << "Compiled result: " << compiled_result
+                     << ", answer: " << answer << endl;
+                return -1;
+            }
+        }
+
+        // No allocations once context is warmed up
+        unsigned counter = 0;
+        for (const Params& params : rows)
+            eval(context, tree, params, &counter);
+        std::size_t alloc_num_before = alloc_num;
+        for (unsigned i = 0; i < 100; ++i)
+            for (const Params& params : rows)
+                eval(context, tree, params, &counter);
+        if (alloc_num != alloc_num_before) {
+            cerr << "Unexpected allocations: "
+                 << (alloc_num - alloc_num_before) << endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
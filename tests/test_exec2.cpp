@@ -0,0 +1,157 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+static Value plus(const Arguments& args, DataPtr) {
+    return args[0] + args[1];
+}
+
+static Value neg(ArgumentSpan args, DataPtr) {
+    return -args[0];
+}
+
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// Count steps until tree is evaluated
+static unsigned count_steps(Exec& exec, Params& params) {
+    exec.init(&params);
+    unsigned step_num = 0;
+    while (!exec.is_finished()) {
+        exec.step();
+        ++step_num;
+    }
+    return step_num;
+}
+
+#define CHECK_EQ(_value, _expected)                                     \
+    if ((_value) != (_expected)) {                                      \
+        cerr << #_value << " = " << (_value)                            \
+             << ", expected " << (_expected) << endl;                   \
+        return -1;                                                      \
+    }
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("+", 2, &::plus, 1);
+    env.add_span_function("neg", 1, &::neg);
+    env.add_select_function("if", 2, 1, &::pos, 2);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    Parser p(&env);
+    PARSE(p, "(+ (neg x) (if (+ x y) (neg 1)))");
+    Tree tree(&env, p.move_result());
+
+    // Condition is true, branch 0 is condition value
+    Params params{1, 2};
+    {
+        Exec exec(tree, Exec::FlagStopOnFunctions);
+        CHECK_EQ(count_steps(exec, params), 3u);
+        CHECK_EQ(exec.result(), 2);
+    }
+    {
+        Exec exec(tree, Exec::FlagStopOnSelects | Exec::FlagStopOnFinished);
+        CHECK_EQ(count_steps(exec, params), 2u);
+        CHECK_EQ(exec.result(), 2);
+    }
+    {
+        Exec exec(tree, Exec::FlagStopIfCostNotZero);
+        CHECK_EQ(count_steps(exec, params), 3u);
+        CHECK_EQ(exec.cost_used(), 4);
+        CHECK_EQ(exec.result(), 2);
+    }
+
+    // Condition is false, branch 1 is evaluated after select
+    params = {1, -5};
+    {
+        Exec exec(tree, Exec::FlagStopOnFunctions);
+        CHECK_EQ(count_steps(exec, params), 4u);
+        CHECK_EQ(exec.result(), -2);
+    }
+    {
+        Exec exec(tree, Exec::FlagStopOnFinished);
+        exec.init(&params);
+        exec.run();
+        CHECK_EQ(exec.result(), eval(tree, params));
+    }
+
+    // Execution restarts after tree is evaluated
+    {
+        Exec exec(tree, Exec::FlagStopOnFunctions);
+        exec.init(&params);
+        for (unsigned n = 1; n <= 12; ++n) {
+            exec.step();
+            CHECK_EQ(exec.is_finished(), (n % 4 == 0));
+        }
+        CHECK_EQ(exec.result(), -2);
+    }
+
+    // Cost limit
+    {
+        Exec exec(tree, Exec::FlagStopOnFinished);
+        exec.set_cost_limit(3);
+        exec.init(&params);
+        try {
+            exec.run();
+            cerr << "Cost limit not exceeded" << endl;
+            return -1;
+        } catch (const ExecCostLimitExceeded&) {}
+    }
+
+    // Cost limit, no exception
+    {
+        Exec exec(tree, Exec::FlagStopOnFinished | Exec::FlagNoThrow);
+        exec.set_cost_limit(3);
+        exec.init(&params);
+        CHECK_EQ(exec.run(), Exec::StatusCostLimitExceeded);
+        CHECK_EQ(exec.status(), Exec::StatusCostLimitExceeded);
+        CHECK_EQ(exec.is_finished(), false);
+        CHECK_EQ(exec.cost_used(), 3);
+        // Root is not evaluated
+        std::ostringstream ss;
+        ExecDebug(exec).print_backtrace(ss);
+        CHECK_EQ(ss.str(), "#0 + : -1 -1 \n");
+        // Stopped again
+        CHECK_EQ(exec.step(), Exec::StatusCostLimitExceeded);
+        CHECK_EQ(exec.cost_used(), 3);
+        // Continue with higher limit
+        exec.set_cost_limit(4);
+        CHECK_EQ(exec.run(), Exec::StatusOk);
+        CHECK_EQ(exec.status(), Exec::StatusOk);
+        CHECK_EQ(exec.result(), -2);
+        CHECK_EQ(exec.cost_used(), 4);
+    }
+
+    // Deep tree, execution is not recursive
+    {
+        const unsigned depth = 200000;
+        env.node_manager().set_arena(true);
+        Id root = env.make_id(env.symbols().by_name("x"));
+        for (unsigned n = 0; n < depth; ++n) {
+            Id id = env.make_id(env.symbols().by_name("neg"));
+            id::nth_argument(env.node_manager(), id, 0) = root;
+            root = id;
+        }
+        Tree deep(&env, root);
+        params = {3, 0};
+        Exec exec(deep, Exec::FlagStopOnFunctions);
+        CHECK_EQ(count_steps(exec, params), depth);
+        CHECK_EQ(exec.result(), 3);
+        exec.set_flag(Exec::FlagStopOnFinished);
+        exec.unset_flag(Exec::FlagStopOnFunctions);
+        params = {-3, 0};
+        exec.init(&params);
+        exec.run();
+        CHECK_EQ(exec.result(), -3);
+        env.node_manager().release();
+    }
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+static Value plus(const Arguments& args, DataPtr) {
+    return args[0] + args[1];
+}
+
+static Value neg(ArgumentSpan args, DataPtr) {
+    return -args[0];
+}
+
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// Step state: backtrace, cost and result
+static string state(Exec& exec) {
+    std::ostringstream ss;
+    ExecDebug(exec).print_backtrace(ss);
+    ss << "cost " << exec.cost_used();
+    if (exec.is_finished())
+        ss << ", result " << exec.result();
+    return ss.str();
+}
+
+// States after each step until tree is evaluated
+static vector<string> run(Exec& exec) {
+    vector<string> states;
+    while (!exec.is_finished()) {
+        exec.step();
+        states.push_back(state(exec));
+    }
+    return states;
+}
+
+static bool check_states(
+    const vector<string>& states,
+    const vector<string>& answers,
+    std::size_t first)
+{
+    if (states.size() != answers.size() - first) {
+        cerr << "Expected " << answers.size() - first << " steps, got "
+             << states.size() << endl;
+        return false;
+    }
+    for (std::size_t n = 0; n < states.size(); ++n) {
+        if (states[n] != answers[first + n]) {
+            cerr << "Step " << first + n << ":" << endl << states[n] << endl
+                 << "expected:" << endl << answers[first + n] << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("+", 2, &::plus, 1);
+    env.add_span_function("neg", 1, &::neg);
+    env.add_select_function("if", 2, 1, &::pos, 2);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    Parser p(&env);
+    PARSE(p,
+          "(+ (neg (+ x (if (+ x y) (neg (+ 1 y)))))"
+          "   (if (neg x) (+ (neg y) (if y (neg (neg x))))))");
+    Tree tree(&env, p.move_result());
+    Params params{1, -5};
+    const Exec::Flag flags = Exec::FlagStopOnFunctions;
+
+    // Reference run
+    vector<string> answers;
+    {
+        Exec exec(tree, flags);
+        exec.init(&params);
+        answers = run(exec);
+        cout << "Steps: " << answers.size() << endl;
+        if (answers.size() < 5) {
+            cerr << "Too few steps" << endl;
+            return -1;
+        }
+    }
+
+    for (std::size_t first = 0; first < answers.size(); ++first) {
+        // Fork, both continue independently
+        {
+            Exec exec(tree, flags);
+            exec.init(&params);
+            for (std::size_t n = 0; n < first; ++n)
+                exec.step();
+            Exec fork = exec.fork();
+            if (!check_states(run(fork), answers, first)
+                || !check_states(run(exec), answers, first))
+                return -1;
+        }
+
+        // Snapshot, run, restore and run again
+        {
+            Exec exec(tree, flags);
+            exec.init(&params);
+            for (std::size_t n = 0; n < first; ++n)
+                exec.step();
+            ExecSnapshot snapshot = exec.snapshot();
+            exec.step();
+            ExecSnapshot snapshot2 = exec.snapshot();
+            if (!check_states(run(exec), answers, first + 1))
+                return -1;
+            exec.restore(snapshot);
+            if (!check_states(run(exec), answers, first))
+                return -1;
+            exec.restore(snapshot2);
+            if (!check_states(run(exec), answers, first + 1))
+                return -1;
+        }
+
+        // Save and load for copy of tree
+        {
+            Exec exec(tree, flags);
+            exec.init(&params);
+            for (std::size_t n = 0; n < first; ++n)
+                exec.step();
+            std::stringstream ss;
+            exec.save(ss);
+
+            Tree copy(tree);
+            Exec exec_copy(copy, flags);
+            exec_copy.init(&params);
+            exec_copy.load(ss);
+            if (!check_states(run(exec_copy), answers, first))
+                return -1;
+        }
+    }
+
+    // Many forks of deep execution
+    {
+        Id root = env.make_id(env.symbols().by_name("x"));
+        for (unsigned n = 0; n < 1000; ++n) {
+            Id id = env.make_id(env.symbols().by_name("neg"));
+            id::nth_argument(env.node_manager(), id, 0) = root;
+            root = id;
+        }
+        Tree deep(&env, root);
+        Exec exec(deep, flags);
+        exec.init(&params);
+        exec.step();
+        vector<Exec> forks;
+        for (unsigned n = 0; n < 100; ++n)
+            forks.push_back(exec.fork());
+        for (Exec& fork : forks) {
+            fork.set_flag(Exec::FlagStopOnFinished);
+            fork.unset_flag(Exec::FlagStopOnFunctions);
+            fork.run();
+            if (fork.result() != params[0]) {
+                cerr << "Wrong deep result " << fork.result() << endl;
+                return -1;
+            }
+        }
+    }
+
+    // Errors
+    {
+        Tree other(tree);
+        Exec exec(tree, flags);
+        exec.init(&params);
+        exec.step();
+        ExecSnapshot snapshot = exec.snapshot();
+        Exec other_exec(other, flags);
+        try {
+            other_exec.restore(snapshot);
+            cerr << "Restored snapshot of other tree" << endl;
+            return -1;
+        } catch (const std::invalid_argument&) {}
+
+        std::stringstream ss;
+        exec.save(ss);
+        string data = ss.str();
+        for (std::size_t size : {std::size_t(0), std::size_t(7), data.size() - 1}) {
+            std::stringstream bad(data.substr(0, size));
+            try {
+                other_exec.load(bad);
+                cerr << "Loaded truncated snapshot" << endl;
+                return -1;
+            } catch (const std::runtime_error& e) {
+                cout << e.what() << endl;
+            }
+        }
+
+        // Malformed frames
+        const std::size_t frame_num_offset =
+            sizeof(std::uint64_t) + sizeof(std::uint32_t)
+            + sizeof(std::uint8_t) + sizeof(Value) + sizeof(Cost);
+        const std::size_t frame_offset =
+            frame_num_offset + sizeof(std::uint64_t);
+        auto patch = [](string& data, std::size_t offset, std::uint64_t value) {
+            data.replace(
+                offset, sizeof(value),
+                reinterpret_cast<const char*>(&value), sizeof(value));
+        };
+        std::uint64_t frame_num;
+        data.copy(reinterpret_cast<char*>(&frame_num), sizeof(frame_num), frame_num_offset);
+        if (frame_num < 2) {
+            cerr << "Too few frames saved" << endl;
+            return -1;
+        }
+        std::size_t frame1_offset = frame_offset + sizeof(std::uint64_t)
+            + sizeof(std::uint8_t)
+            + static_cast<std::uint8_t>(data[frame_offset + sizeof(std::uint64_t)]) * sizeof(Value);
+        vector<string> malformed(3, data);
+        // no frames, not finished
+        malformed[0].resize(frame_offset);
+        patch(malformed[0], frame_num_offset, 0);
+        // first frame is not root
+        patch(malformed[1], frame_offset, 1);
+        // second frame is not argument of first one
+        patch(malformed[2], frame1_offset, 0);
+        for (const string& bad_data : malformed) {
+            std::stringstream bad(bad_data);
+            try {
+                other_exec.load(bad);
+                cerr << "Loaded malformed snapshot" << endl;
+                return -1;
+            } catch (const std::runtime_error& e) {
+                cout << e.what() << endl;
+            }
+        }
+    }
+    return 0;
+}
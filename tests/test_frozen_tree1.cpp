@@ -0,0 +1,119 @@
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+static Value plus(const Arguments& args, DataPtr) {
+    return args[0] + args[1];
+}
+
+static Value mult(const Arguments& args, DataPtr) {
+    return args[0] * args[1];
+}
+
+static Value inc(const Arguments&, DataPtr data) {
+    return ++(*static_cast<unsigned*>(data));
+}
+
+// (pos x y): return x if positive, evaluate y otherwise
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// (flip x y): evaluate x or y depending on side effect counter
+static unsigned flip(const Arguments&, DataPtr data) {
+    return *static_cast<unsigned*>(data) % 2;
+}
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("+", 2, &::plus);
+    env.add_function("*", 2, &::mult);
+    env.add_function("inc", 0, &::inc);
+    env.add_select_function("pos", 2, 1, &::pos);
+    env.add_select_function("flip", 2, 0, &::flip);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    vector<string> tss{
+        "x",
+        "2.5",
+        "(+ x y)",
+        "(pos (+ x y) (* x (inc)))",
+        "(flip (+ (inc) (pos x (inc))) (pos y (inc)))",
+        "(+ (pos x (* y (inc))) (flip (pos (inc) x) (+ (inc) (flip 3 y))))"
+    };
+    vector<Params> rows{
+        {0, 0}, {1, 2}, {2, 1}, {-3, 4}, {5, -1.5}, {-2, -2}
+    };
+
+    Parser p(&env);
+    vector<FrozenTree> frozen;
+    EvalContext context;
+    for (const string& ts : tss) {
+        PARSE(p, ts);
+        Tree tree(&env, p.move_result());
+        frozen.emplace_back(tree);
+        const FrozenTree& ft = frozen.back();
+        if (ft.size() != tree.describe().size || ft.root().size != ft.size()) {
+            cerr << "Invalid frozen tree size" << endl;
+            return -1;
+        }
+        CHECK_TREE_STR(ft, ts);
+        if (!ft.equal(tree)) {
+            cerr << "Frozen tree is not equal to original" << endl;
+            return -1;
+        }
+        for (const Params& params : rows) {
+            unsigned data1 = 0;
+            unsigned data2 = 0;
+            Value value1 = eval(tree, params, &data1);
+            Value value2 = ft.eval(context, params, &data2);
+            if (value1 != value2 || data1 != data2) {
+                cerr << "Frozen tree result does not match: " << value2
+                     << ", answer: " << value1 << endl;
+                return -1;
+            }
+        }
+    }
+
+    // Comparison
+    for (unsigned i = 0; i < frozen.size(); ++i) {
+        for (unsigned j = 0; j < frozen.size(); ++j) {
+            if ((frozen[i] == frozen[j]) != (i == j)) {
+                cerr << "Invalid comparison result: "
+                     << frozen[i] << ", " << frozen[j] << endl;
+                return -1;
+            }
+        }
+    }
+    FrozenTree copy = frozen.back();
+    if (copy != frozen.back() || copy.nodes() != frozen.back().nodes()) {
+        cerr << "Copy does not share nodes" << endl;
+        return -1;
+    }
+
+    // Conversion to tree, frozen tree is independent of nodes
+    for (unsigned n = 0; n < frozen.size(); ++n) {
+        Tree tree = frozen[n].to_tree(&env);
+        CHECK_TREE_STR(tree, tss[n]);
+        tree.sub(0).replace(Tree(&env, env.make_id("y")));
+        CHECK_TREE_STR(frozen[n], tss[n]);
+    }
+    auto shard = env.make_shard();
+    CHECK_TREE_STR(frozen.back().to_tree(shard.get()), tss.back());
+    Environment other;
+    try {
+        frozen.back().to_tree(&other);
+        cerr << "Tree made in other environment" << endl;
+        return -1;
+    } catch (const std::invalid_argument&) {}
+    return 0;
+}
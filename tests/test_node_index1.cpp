@@ -0,0 +1,142 @@
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+DEFUN_EMPTY(func);
+
+using namespace std;
+using namespace stree;
+
+using Random = std::mt19937;
+
+static Id grow(Environment& env, unsigned depth, Random& rd) {
+    const SymbolTable& symbols = env.symbols();
+    bool is_term = (depth == 0)
+        || std::uniform_int_distribution<unsigned>{0, 4}(rd) == 0;
+    const SymbolPtrList& list = is_term
+        ? symbols.terminals()
+        : symbols.nonterminals();
+    const SymbolPtr& symbol =
+        list[std::uniform_int_distribution<std::size_t>{0, list.size() - 1}(rd)];
+    Id id = env.make_id(symbol);
+    for (Arity n = 0; n < id.arity(); ++n) {
+        Id argument = grow(env, depth - 1, rd);
+        id::nth_argument(env.node_manager(), id, n) = argument;
+    }
+    return id;
+}
+
+// Index entries match nodes found by nth_node
+static bool check(Tree& tree, const NodeIndex& index, const NodeFilter& filter) {
+    NodeManager& nm = tree.env()->node_manager();
+    NodeNum num = index.count(filter);
+    for (NodeNum n = 0; n < num; ++n) {
+        NodeNum depth;
+        Id& id = id::nth_node(nm, tree.root(), n, filter, depth);
+        const NodeIndexEntry& entry = index.nth(n, filter);
+        if (entry.id != &id
+            || entry.depth != depth
+            || entry.arity != id.arity()
+            || entry.size != id::subtree_size(nm, id))
+        {
+            cerr << "Wrong entry " << n << " in " << tree << endl;
+            return false;
+        }
+    }
+    try {
+        id::nth_node(nm, tree.root(), num, filter);
+        cerr << "Wrong node number " << num << " in " << tree << endl;
+        return false;
+    } catch (const std::range_error&) {}
+    try {
+        index.nth(num, filter);
+        cerr << "No error for node " << num << endl;
+        return false;
+    } catch (const std::range_error&) {}
+    return true;
+}
+
+static bool check(Tree& tree, const NodeIndex& index) {
+    std::vector<NodeFilter> filters(7);
+    filters[1].is_terminal = IsTerminalYes;
+    filters[2].is_terminal = IsTerminalNo;
+    filters[3].arity.add(2);
+    filters[4].arity.add(1);
+    filters[4].arity.add(3);
+    filters[5].arity.add(0);
+    filters[5].arity.add(2);
+    filters[5].is_terminal = IsTerminalNo;
+    filters[6].arity.add(4);
+    for (const NodeFilter& filter : filters)
+        if (!check(tree, index, filter))
+            return false;
+    const TreeDescription& description = tree.describe();
+    return index.size() == description.size
+        && index.term_num() == description.term_num
+        && index.nonterm_num() == description.nonterm_num;
+}
+
+#define CHECK(_cond)                                            \
+    if (!(_cond)) {                                             \
+        cerr << "Check failed: " << #_cond << endl;             \
+        return -1;                                              \
+    }
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("f1", 1, &func);
+    env.add_function("f2", 2, &func);
+    env.add_function("f3", 3, &func);
+    env.add_positional("x", 0);
+    env.add_constant("one", 1);
+
+    {
+        Parser p(&env);
+        PARSE(p, "(f2 x (f3 (f2 x x) one (f1 x)))");
+        Tree tree(&env, p.move_result());
+        NodeIndex index(tree);
+        CHECK(index.is_valid());
+        CHECK(index.size() == 9);
+        CHECK(index.nth(2).size == 7);
+        CHECK(index.nth(2).depth == 1);
+        CHECK(to_string(index.sub(5)) == "(f1 x)");
+        CHECK(to_string(index.term(1)) == "1");
+        CHECK(to_string(index.nonterm(3)) == "(f1 x)");
+        CHECK(check(tree, index));
+
+        // Rebuild after modification
+        index.sub(5).replace(Tree(&env, env.symbols().by_name("x")));
+        index.invalidate();
+        CHECK(!index.is_valid());
+        index.build(tree);
+        CHECK(to_string(tree) == "(f2 x (f3 (f2 x x) 1 x))");
+        CHECK(index.size() == 8);
+        CHECK(check(tree, index));
+    }
+
+    // Empty tree
+    {
+        Tree tree(&env);
+        NodeIndex index(tree);
+        CHECK(index.size() == 0);
+        try {
+            index.nth(0);
+            cerr << "No error for empty tree" << endl;
+            return -1;
+        } catch (const std::range_error&) {}
+    }
+
+    Random rd(11);
+    for (unsigned iteration = 0; iteration < 200; ++iteration) {
+        Tree tree(&env, grow(env, 1 + iteration % 7, rd));
+        NodeIndex index(tree);
+        if (!check(tree, index))
+            return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+#include "node_manager_macros.hpp"
+
+DEFUN_EMPTY(func);
+
+int main() {
+    using namespace std;
+    using namespace stree;
+
+    // Init environment
+    Environment env;
+    env.add_function("+", 2, &func);
+    env.add_positional("a", 0);
+    NodeManager& nm = env.node_manager();
+    NodeManagerStats nms;
+
+    // Freed nodes are reused in LIFO order
+    vector<Id> ids;
+    for (unsigned n = 0; n < 4; ++n) {
+        ids.push_back(id::make(nm, TypePositional));
+        id::set_position(nm, ids.back(), n + 1);
+    }
+    vector<Id> freed{ids[0], ids[2], ids[1]};
+    for (unsigned n = 0; n < freed.size(); ++n) {
+        Id id = freed[n];
+        id::destroy(nm, id);
+    }
+    nms.update(nm);
+    CHECK_STATS(nms, TypePositional, 0, 4, 3);
+    for (unsigned n = freed.size(); n > 0; --n) {
+        Id id = id::make(nm, TypePositional);
+        if (id != freed[n - 1]) {
+            cerr << "Expected node " << freed[n - 1]
+                 << ", got " << id << endl;
+            return -1;
+        }
+        // reused node is reset
+        if (id::position(nm, id) != 0) {
+            cerr << "Reused node is not reset" << endl;
+            return -1;
+        }
+    }
+    nms.update(nm);
+    CHECK_STATS(nms, TypePositional, 0, 4, 0);
+    Id id = id::make(nm, TypePositional);
+    nms.update(nm);
+    CHECK_STATS(nms, TypePositional, 0, 5, 0);
+
+    // Function nodes
+    Id f1 = id::make(nm, TypeFunction, 2);
+    Id f2 = id::make(nm, TypeFunction, 2);
+    id::destroy(nm, f1);
+    id::destroy(nm, f2);
+    id::destroy(nm, id);
+    nms.update(nm);
+    CHECK_STATS(nms, TypeFunction, 2, 2, 2);
+    CHECK_STATS(nms, TypePositional, 0, 5, 1);
+    {
+        Parser p(&env);
+        PARSE(p, "(+ a a)");
+        Tree tree(&env, p.move_result());
+        nms.update(nm);
+        CHECK_STATS(nms, TypeFunction, 2, 2, 1);
+        CHECK_STATS(nms, TypePositional, 0, 6, 0);
+    }
+    nms.update(nm);
+    CHECK_STATS(nms, TypeFunction, 2, 2, 2);
+    CHECK_STATS(nms, TypePositional, 0, 6, 2);
+
+    // Merging free lists
+    {
+        auto shard = env.make_shard();
+        NodeManager& shard_nm = shard->node_manager();
+        Parser p(shard.get());
+        PARSE(p, "(+ (+ a a) a)");
+        Tree tree(shard.get(), p.move_result());
+        Tree tmp(shard.get(), shard->make_id("a"));
+        tmp.sub(0).destroy();
+        vector<Tree> trees;
+        trees.push_back(std::move(tree));
+        trees = env.merge(*shard, std::move(trees));
+        nms.update(nm);
+        CHECK_STATS(nms, TypeFunction, 2, 4, 2);
+        CHECK_STATS(nms, TypePositional, 0, 10, 3);
+        nms.update(shard_nm);
+        CHECK_STATS(nms, TypePositional, 0, 0, 0);
+        CHECK_TREE_STR(trees[0], "(+ (+ a a) a)");
+        // all free nodes are reused before pool grows
+        for (unsigned n = 0; n < 3; ++n)
+            ids[n] = env.make_id("a");
+        nms.update(nm);
+        CHECK_STATS(nms, TypePositional, 0, 10, 0);
+        for (unsigned n = 0; n < 3; ++n)
+            id::destroy(nm, ids[n]);
+    }
+
+    // Release
+    nm.release();
+    nms.update(nm);
+    CHECK_STATS(nms, TypePositional, 0, 10, 10);
+    CHECK_STATS(nms, TypeFunction, 2, 4, 4);
+    env.make_id("a");
+    nms.update(nm);
+    CHECK_STATS(nms, TypePositional, 0, 10, 9);
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+DEFUN_EMPTY(func);
+
+using namespace std;
+using namespace stree;
+
+// Parse with parallel parser, result should match BulkParser
+static bool check_same(
+    ParallelParser& pp,
+    Environment& env,
+    const string& input)
+{
+    BulkParser bp(&env);
+    vector<Tree> answers = bp.make_trees(bp.parse(input));
+    vector<Tree> trees = pp.parse(env, input);
+    if (trees.size() != answers.size()) {
+        cerr << "Expected " << answers.size() << " trees, got "
+             << trees.size() << endl;
+        return false;
+    }
+    for (std::size_t n = 0; n < trees.size(); ++n) {
+        if (trees[n].env() != &env) {
+            cerr << "Tree does not belong to environment" << endl;
+            return false;
+        }
+        CHECK_TREE_STR(trees[n], to_string(answers[n]));
+    }
+    return true;
+}
+
+// Error position should match BulkParser
+static bool check_error(
+    ParallelParser& pp,
+    Environment& env,
+    const string& input)
+{
+    std::size_t line_num = 0;
+    std::size_t char_num = 0;
+    try {
+        BulkParser bp(&env);
+        bp.parse(input);
+        cerr << "No error" << endl;
+        return false;
+    } catch (const ParserError& e) {
+        line_num = e.line_num();
+        char_num = e.char_num();
+    }
+    try {
+        pp.parse(env, input);
+        cerr << "No error, chunk size " << pp.chunk_size() << endl;
+        return false;
+    } catch (const ParserError& e) {
+        cout << e.what() << endl;
+        if (e.line_num() != line_num || e.char_num() != char_num) {
+            cerr << "Expected line " << line_num << " char " << char_num
+                 << ", chunk size " << pp.chunk_size() << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("+", 2, &func);
+    env.add_function("neg", 1, &func);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    string input;
+    for (unsigned n = 0; n < 100; ++n) {
+        input += "(+ x (neg " + std::to_string(n) + "))";
+        input += (n % 3 == 0) ? "\n" : " ";
+        if (n % 10 == 0)
+            input += "y  (neg\n  (+ x y))\n";
+    }
+
+    Scheduler scheduler(3);
+    for (std::size_t chunk_size : {1, 7, 64, 1000, 1 << 20}) {
+        ParallelParser pp(scheduler, chunk_size);
+        if (!check_same(pp, env, input)
+            || !check_same(pp, env, "x")
+            || !check_same(pp, env, " \n ")
+            || !check_same(pp, env, ""))
+            return -1;
+
+        // Errors in different chunks, first one is reported
+        if (!check_error(pp, env, input + "(neg z)")
+            || !check_error(pp, env, input + "\n  (+ x\n y z)\n" + input)
+            || !check_error(pp, env, input + " x)" + input + "(")
+            || !check_error(pp, env, "(+ x\ny)  " + input + "Y")
+            || !check_error(pp, env, input + "(neg (neg x)"))
+            return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+// Throws for large arguments
+static Value check(const Arguments& args, DataPtr) {
+    if (args[0] > 1000)
+        throw std::range_error("Argument is too large");
+    return args[0];
+}
+
+// Counts calls
+static Value count(const Arguments& args, DataPtr data) {
+    ++(*static_cast<std::atomic<unsigned>*>(data));
+    return args[0];
+}
+
+// (pos x y): return x if positive, evaluate y otherwise
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+int main() {
+    // Init environment
+    Environment env;
+    for (const string& name : builtin_names())
+        add_builtin(env, name);
+    env.add_function("check", 1, &::check);
+    env.add_function("count", 1, &::count);
+    env.add_select_function("pos", 2, 1, &::pos);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    vector<string> tss{
+        "x",
+        "1.5",
+        "(+ x y)",
+        "(count (* x (- y 1)))",
+        "(pos (- x y) (% x (count y)))",
+        "(max (pos x (* y y)) (min x (count (+ y 2))))",
+        "(check (pos (* x y) (- (* 2 x) y)))"
+    };
+
+    // Fitness cases, row number is not multiple of block size
+    const std::size_t row_num = 1000;
+    std::mt19937 prng(1);
+    std::uniform_real_distribution<Value> dist(-10, 10);
+    vector<Params> rows(row_num);
+    for (Params& params : rows)
+        params = {dist(prng), dist(prng)};
+    ParamMatrix matrix(rows);
+
+    // Make population, some trees repeated
+    vector<Tree> trees;
+    Parser p(&env);
+    for (unsigned n = 0; n < 3; ++n) {
+        for (const string& ts : tss) {
+            PARSE(p, ts);
+            trees.emplace_back(&env, p.move_result());
+        }
+    }
+
+    // Answers
+    vector<Value> answers;
+    std::atomic<unsigned> count_answer{0};
+    for (const Tree& tree : trees)
+        for (const Params& params : rows)
+            answers.push_back(eval(tree, params, &count_answer));
+
+    for (unsigned worker_num : {1, 2, 3, 8}) {
+        Scheduler scheduler(worker_num);
+        PopulationEval population_eval(scheduler, 64);
+        vector<Value> results(trees.size() * row_num);
+        std::atomic<unsigned> counter{0};
+        population_eval.eval(trees, matrix, results.data(), &counter);
+        cout << "Workers: " << worker_num
+             << ", count: " << counter << ", answer: " << count_answer << endl;
+        if (counter != count_answer)
+            return -1;
+        for (std::size_t n = 0; n < results.size(); ++n) {
+            if (results[n] != answers[n]) {
+                cerr << "Tree " << (n / row_num) << ", row " << (n % row_num)
+                     << ": result " << results[n]
+                     << ", answer: " << answers[n] << endl;
+                return -1;
+            }
+        }
+        if (env.node_manager().is_frozen()) {
+            cerr << "Node manager is still frozen" << endl;
+            return -1;
+        }
+
+        // Exception from function is rethrown, scheduler can be reused
+        ParamMatrix large(vector<Params>(300, Params{2000, 1}));
+        results.resize(trees.size() * large.row_num());
+        try {
+            population_eval.eval(trees, large, results.data(), &counter);
+            cerr << "Exception expected" << endl;
+            return -2;
+        } catch (const std::range_error&) {}
+        std::atomic<unsigned> task_num{0};
+        scheduler.run(100, [&task_num](std::size_t, unsigned) { ++task_num; });
+        if (task_num != 100) {
+            cerr << "Task number: " << task_num << endl;
+            return -1;
+        }
+    }
+
+    // Frozen node manager
+    env.node_manager().freeze();
+    try {
+        env.make_id("x");
+        cerr << "Exception expected" << endl;
+        return -3;
+    } catch (const std::logic_error&) {}
+    env.node_manager().unfreeze();
+    env.make_id("x");
+
+    return 0;
+}
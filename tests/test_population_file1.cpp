@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+static const char* Path = "test_population_file1.bin";
+
+static Value plus(const Arguments& args, DataPtr) {
+    return args[0] + args[1];
+}
+
+static Value mult(const Arguments& args, DataPtr) {
+    return args[0] * args[1];
+}
+
+// (pos x y): return x if positive, evaluate y otherwise
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+static const vector<string> Strings = {
+    "x",
+    "1.5",
+    "(+ x y)",
+    "(pos (+ x y) (* x 2))",
+    "(* (pos y x) (+ (pos x 3) y))"
+};
+
+static const vector<Params> Rows = {{0, 0}, {1, 2}, {-3, 4}, {5, -1.5}};
+
+// Check that mapped trees are same as original ones
+static bool check(
+    Environment& env,
+    const MappedPopulation& population,
+    bool zero_copy)
+{
+    if (population.is_zero_copy() != zero_copy) {
+        cerr << "Expected " << (zero_copy ? "zero-copy" : "remapped")
+             << " population" << endl;
+        return false;
+    }
+    if (population.size() != Strings.size()) {
+        cerr << "Invalid tree number: " << population.size() << endl;
+        return false;
+    }
+    Parser p(&env);
+    for (std::size_t n = 0; n < population.size(); ++n) {
+        FrozenTree tree = population[n];
+        CHECK_TREE_STR(tree, Strings[n]);
+        PARSE(p, Strings[n]);
+        Tree answer(&env, p.move_result());
+        for (const Params& params : Rows) {
+            if (tree.eval(params) != eval(answer, params)) {
+                cerr << "Result does not match" << endl;
+                return false;
+            }
+        }
+        CHECK_TREE_STR(tree.to_tree(&env), Strings[n]);
+    }
+    return true;
+}
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("+", 2, &::plus);
+    env.add_function("*", 2, &::mult);
+    env.add_select_function("pos", 2, 1, &::pos);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    // Save population
+    vector<Tree> trees;
+    Parser p(&env);
+    for (const string& s : Strings) {
+        PARSE(p, s);
+        trees.emplace_back(&env, p.move_result());
+    }
+    save_population(Path, env, trees);
+
+    // Same environment, trees are read from mapped file
+    FrozenTree last = [&env]() {
+        MappedPopulation population(env, Path);
+        if (!check(env, population, true))
+            std::exit(EXIT_FAILURE);
+        if (population.node_num() != 21) {
+            cerr << "Invalid node number: " << population.node_num() << endl;
+            std::exit(EXIT_FAILURE);
+        }
+        return population[population.size() - 1];
+    }();
+    // tree keeps mapping alive
+    CHECK_TREE_STR(last, Strings.back());
+
+    // Symbols in different order, nodes are remapped
+    {
+        Environment other;
+        other.add_positional("y", 0);
+        other.add_positional("x", 1);
+        other.add_function("-", 2, &::plus);
+        other.add_function("*", 2, &::mult);
+        other.add_function("+", 2, &::plus);
+        other.add_select_function("pos", 2, 1, &::pos);
+        MappedPopulation population(other, Path);
+        if (!check(other, population, false))
+            return -1;
+    }
+
+    // Missing symbol
+    {
+        Environment other;
+        other.add_function("+", 2, &::plus);
+        other.add_positional("x", 0);
+        other.add_positional("y", 1);
+        try {
+            MappedPopulation population(other, Path);
+            cerr << "Population loaded with missing symbol" << endl;
+            return -1;
+        } catch (const std::invalid_argument&) {}
+    }
+
+    std::ifstream ifs(Path, std::ios::binary);
+    const string content((std::istreambuf_iterator<char>(ifs)), {});
+    ifs.close();
+
+    // Corrupted header fields: tree number, symbol section offset
+    for (std::size_t field_offset : {32u, 48u}) {
+        string corrupted = content;
+        std::uint64_t field;
+        std::memcpy(&field, &corrupted[field_offset], sizeof(field));
+        field = (field_offset == 32u)
+            ? std::numeric_limits<std::uint64_t>::max()
+            : field + 1;
+        std::memcpy(&corrupted[field_offset], &field, sizeof(field));
+        std::ofstream ofs(Path, std::ios::binary | std::ios::trunc);
+        ofs.write(corrupted.data(), corrupted.size());
+        ofs.close();
+        try {
+            MappedPopulation population(env, Path);
+            cerr << "Corrupted population loaded" << endl;
+            return -1;
+        } catch (const std::runtime_error&) {}
+    }
+
+    // Truncated file
+    {
+        std::ofstream ofs(Path, std::ios::binary | std::ios::trunc);
+        ofs.write(content.data(), content.size() - sizeof(FrozenNode));
+        ofs.close();
+        try {
+            MappedPopulation population(env, Path);
+            cerr << "Truncated population loaded" << endl;
+            return -1;
+        } catch (const std::runtime_error&) {}
+    }
+
+    std::remove(Path);
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+using namespace std;
+using namespace stree;
+
+// (pos x y): return x if positive, evaluate y otherwise
+static unsigned pos(const Arguments& args, DataPtr) {
+    return (args[0] > 0) ? 0 : 1;
+}
+
+// Build random tree, grow method, with some constants
+static Id grow(Environment& env, unsigned depth, std::mt19937& prng) {
+    std::uniform_int_distribution<unsigned> coin(0, 3);
+    if (depth == 1 && coin(prng) == 0)
+        return env.make_id(static_cast<Value>(coin(prng)));
+    const SymbolPtrList& symbols = (depth > 1 && coin(prng) > 0)
+        ? env.symbols().nonterminals()
+        : env.symbols().terminals();
+    std::uniform_int_distribution<std::size_t> dist(0, symbols.size() - 1);
+    Id id = env.make_id(symbols[dist(prng)]);
+    for (Arity n = 0; n < id.arity(); ++n)
+        id::nth_argument(env.node_manager(), id, n) = grow(env, depth - 1, prng);
+    return id;
+}
+
+static std::size_t used_node_num(const NodeManager& nm) {
+    NodeManagerStats stats(nm);
+    std::size_t num = 0;
+    for (const auto& item : stats.items())
+        num += item.pool_size - item.buffer_size;
+    return num;
+}
+
+int main() {
+    // Init environment
+    Environment env;
+    for (const string& name : builtin_names())
+        add_builtin(env, name);
+    env.add_select_function("pos", 2, 1, &::pos);
+    env.add_positional("x", 0);
+    env.add_positional("y", 1);
+
+    // Some trees in main environment
+    std::mt19937 prng(1);
+    vector<Tree> trees;
+    for (unsigned n = 0; n < 10; ++n)
+        trees.emplace_back(&env, grow(env, 5, prng));
+
+    // Build trees on worker threads, each worker with its own shard
+    const unsigned worker_num = 4;
+    const unsigned tree_num = 200;
+    Scheduler scheduler(worker_num);
+    vector<std::unique_ptr<Environment>> shards;
+    vector<vector<Tree>> shard_trees(worker_num);
+    for (unsigned n = 0; n < worker_num; ++n)
+        shards.push_back(env.make_shard());
+    vector<string> answers(tree_num);
+    scheduler.run(tree_num, [&](std::size_t task, unsigned worker) {
+        Environment& shard = *shards[worker];
+        std::mt19937 prng(task);
+        Tree tree(&shard, grow(shard, 6, prng));
+        // free some nodes so that merged pools have buffered nodes
+        Tree tmp(&shard, grow(shard, 3, prng));
+        answers[task] = to_string(tree);
+        shard_trees[worker].push_back(std::move(tree));
+    });
+
+    // Merge shards, check trees
+    vector<string> results;
+    std::size_t node_num = used_node_num(env.node_manager());
+    std::size_t shard_node_num = 0;
+    for (unsigned n = 0; n < worker_num; ++n) {
+        shard_node_num += used_node_num(shards[n]->node_manager());
+        vector<Tree> merged = env.merge(*shards[n], std::move(shard_trees[n]));
+        if (used_node_num(shards[n]->node_manager()) != 0) {
+            cerr << "Shard is not empty after merge" << endl;
+            return -1;
+        }
+        for (Tree& tree : merged) {
+            if (tree.env() != &env || !tree.is_valid()) {
+                cerr << "Invalid merged tree" << endl;
+                return -1;
+            }
+            results.push_back(to_string(tree));
+            trees.push_back(std::move(tree));
+        }
+    }
+    if (used_node_num(env.node_manager()) != node_num + shard_node_num) {
+        cerr << "Unexpected number of nodes after merge" << endl;
+        return -1;
+    }
+    std::sort(answers.begin(), answers.end());
+    std::sort(results.begin(), results.end());
+    if (results != answers) {
+        cerr << "Merged trees don't match" << endl;
+        return -1;
+    }
+
+    // Merged trees can be evaluated, modified and destroyed
+    for (Tree& tree : trees) {
+        eval(tree, Params({1, 2}));
+        Tree branch(&env, grow(env, 3, prng));
+        if (tree.describe().size > 1)
+            tree.sub(1).replace(branch);
+    }
+
+    // Shard can be reused, copying single tree from shard
+    {
+        Environment& shard = *shards[0];
+        Tree tree(&shard, grow(shard, 5, prng));
+        Tree copy(&env, tree);
+        CHECK_TREE_STR(copy, to_string(tree));
+    }
+
+    // Trees are left intact if some tree is not from shard
+    {
+        Environment& shard = *shards[0];
+        vector<Tree> mixed;
+        mixed.emplace_back(&shard, grow(shard, 5, prng));
+        mixed.emplace_back(&env, grow(env, 5, prng));
+        string answer = to_string(mixed[0]);
+        try {
+            env.merge(shard, std::move(mixed));
+            cerr << "Exception expected" << endl;
+            return -2;
+        } catch (const std::invalid_argument&) {}
+        if (mixed.size() != 2 || !mixed[0].is_valid()) {
+            cerr << "Trees modified by failed merge" << endl;
+            return -1;
+        }
+        CHECK_TREE_STR(mixed[0], answer);
+    }
+
+    // Deep tree is merged without recursion
+    {
+        Environment& shard = *shards[0];
+        const unsigned depth = 1000000;
+        Id root = shard.make_id(shard.symbols().by_name("x"));
+        for (unsigned n = 0; n < depth; ++n) {
+            Id id = shard.make_id(shard.symbols().by_name("+"));
+            id::nth_argument(shard.node_manager(), id, 0) = root;
+            id::nth_argument(shard.node_manager(), id, 1) =
+                shard.make_id(shard.symbols().by_name("y"));
+            root = id;
+        }
+        vector<Tree> deep;
+        deep.emplace_back(&shard, root);
+        vector<Tree> merged = env.merge(shard, std::move(deep));
+        if (merged.size() != 1 || merged[0].describe().depth != depth) {
+            cerr << "Invalid merged deep tree" << endl;
+            return -1;
+        }
+    }
+
+    // Cannot merge unrelated environment
+    {
+        Environment other;
+        try {
+            env.merge(other, vector<Tree>());
+            cerr << "Exception expected" << endl;
+            return -2;
+        } catch (const std::invalid_argument&) {}
+    }
+
+    trees.clear();
+    if (used_node_num(env.node_manager()) != 0) {
+        cerr << "Nodes not freed" << endl;
+        return -1;
+    }
+    return 0;
+}
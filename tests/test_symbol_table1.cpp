@@ -0,0 +1,97 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+DEFUN_EMPTY(func);
+
+static unsigned cond(const stree::Arguments&, stree::DataPtr) {
+    return 0;
+}
+
+using namespace std;
+using namespace stree;
+
+#define CHECK(_cond)                                            \
+    if (!(_cond)) {                                             \
+        cerr << "Check failed: " << #_cond << endl;             \
+        return -1;                                              \
+    }
+
+#define CHECK_THROWS(_expr, _exception)                         \
+    try {                                                       \
+        _expr;                                                  \
+        cerr << "No exception: " << #_expr << endl;             \
+        return -1;                                              \
+    } catch (const _exception&) {}
+
+int main() {
+    // Init environment, enough symbols to grow name table
+    Environment env;
+    for (unsigned n = 0; n < 50; ++n)
+        env.add_function("f" + std::to_string(n), n % 4, &func);
+    env.add_select_function("if", 2, 1, &cond);
+    env.add_positional("x", 0);
+    env.add_positional("z", 5);
+    env.add_constant("pi", 3.14);
+    const SymbolTable& symbols = env.symbols();
+
+    // Names
+    for (std::size_t n = 0; n < symbols.size(); ++n) {
+        const SymbolPtr& symbol = symbols[n];
+        CHECK(symbols.find(symbol->name()) == symbol);
+        CHECK(symbols.by_name(symbol->name()) == symbol);
+    }
+    CHECK(!symbols.find("y"));
+    CHECK(!symbols.find(""));
+    CHECK(!symbols.find("f50"));
+    CHECK_THROWS(symbols.by_name("y"), std::out_of_range);
+
+    // Indices
+    CHECK(symbols.find_by_fid(10) == symbols.find("f10"));
+    CHECK(symbols.find_by_sfid(0) == symbols.find("if"));
+    CHECK(symbols.find_by_position(5) == symbols.find("z"));
+    CHECK(!symbols.find_by_position(1));
+    CHECK(!symbols.find_by_position(6));
+    CHECK(!symbols.find_by_fid(50));
+    CHECK(!symbols.find_by_sfid(1));
+    CHECK_THROWS(symbols.by_position(1), std::out_of_range);
+    CHECK_THROWS(symbols.by_fid(200), std::out_of_range);
+    CHECK_THROWS(symbols.by_sfid(1), std::out_of_range);
+
+    // IDs
+    {
+        Parser p(&env);
+        PARSE(p, "(f2 (f1 x) 1)");
+        Tree tree(&env, p.move_result());
+        CHECK(symbols.find_by_id(tree.root()) == symbols.find("f2"));
+        CHECK(symbols.by_id(tree.root()) == symbols.find("f2"));
+        const Id& value = id::nth_argument(
+            env.node_manager(), tree.root(), 1);
+        CHECK(!symbols.find_by_id(value));
+        CHECK_THROWS(symbols.by_id(value), std::invalid_argument);
+    }
+
+    // Duplicates are rejected, table is not changed
+    std::size_t size = symbols.size();
+    CHECK_THROWS(env.add_positional("x", 1), std::out_of_range);
+    CHECK_THROWS(env.add_positional("y", 0), std::out_of_range);
+    CHECK(symbols.size() == size);
+    CHECK(!symbols.find("y"));
+    CHECK(!symbols.find_by_position(1));
+    env.add_positional("y", 1);
+    CHECK(symbols.find_by_position(1) == symbols.find("y"));
+
+    // Unknown symbol is parser error
+    {
+        Parser p1(&env);
+        p1.parse("(f2 x w)");
+        CHECK(p1.is_error());
+        CHECK(p1.error() == Parser::ErrorSymbolNotFound);
+        Parser p2(&env);
+        p2.parse("(w x)");
+        CHECK(p2.error() == Parser::ErrorSymbolNotFound);
+    }
+    return 0;
+}
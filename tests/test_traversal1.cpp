@@ -0,0 +1,125 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+DEFUN_EMPTY(func);
+
+using namespace std;
+using namespace stree;
+
+#define CHECK(_cond)                                            \
+    if (!(_cond)) {                                             \
+        cerr << "Check failed: " << #_cond << endl;             \
+        return -1;                                              \
+    }
+
+// Symbol names and depths in visiting order
+using Visited = std::vector<std::pair<std::string, NodeNum>>;
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("f1", 1, &func);
+    env.add_function("f2", 2, &func);
+    env.add_positional("a", 0);
+    env.add_positional("b", 1);
+    env.add_positional("c", 2);
+    env.add_positional("d", 3);
+    NodeManager& nm = env.node_manager();
+
+    // Visiting order
+    {
+        Parser p(&env);
+        PARSE(p, "(f2 (f2 a b) (f1 (f2 c d)))");
+        Tree tree(&env, p.move_result());
+        const Id& root = tree.root();
+        auto visit = [&](Visited& visited) {
+            return [&env, &visited](const Id& id, NodeNum depth) {
+                std::string symbol = (id.arity() == 0)
+                    ? to_string(Tree(&env, id::copy(env.node_manager(), id)))
+                    : (id.arity() == 1 ? "f1" : "f2");
+                visited.emplace_back(symbol, depth);
+                return false;
+            };
+        };
+        Visited pre, post, bfs;
+        CHECK(!id::preorder(nm, root, visit(pre)));
+        CHECK(!id::postorder(nm, root, visit(post)));
+        CHECK(!id::bfs(nm, root, visit(bfs)));
+        CHECK((pre == Visited{
+                    {"f2", 0}, {"f2", 1}, {"a", 2}, {"b", 2},
+                    {"f1", 1}, {"f2", 2}, {"c", 3}, {"d", 3}}));
+        CHECK((post == Visited{
+                    {"a", 2}, {"b", 2}, {"f2", 1},
+                    {"c", 3}, {"d", 3}, {"f2", 2}, {"f1", 1}, {"f2", 0}}));
+        CHECK((bfs == Visited{
+                    {"f2", 0}, {"f2", 1}, {"f1", 1}, {"a", 2},
+                    {"b", 2}, {"f2", 2}, {"c", 3}, {"d", 3}}));
+
+        // Stop
+        unsigned num = 0;
+        CHECK(id::preorder(nm, root, [&num](const Id&, NodeNum) {
+            return ++num == 3;
+        }));
+        CHECK(num == 3);
+
+        // for_each_node numbers nodes in BFS order
+        NodeNum last = 0;
+        bool same = true;
+        id::for_each_node(nm, root, [&](const Id& id, NodeNum n, NodeNum) {
+            same = same && &id == &id::nth_node(nm, root, n);
+            last = n;
+            return false;
+        });
+        CHECK(same);
+        CHECK(last == 7);
+    }
+
+    // Wide tree, BFS levels do not fit inline buffers
+    {
+        Tree tree(&env, env.symbols().by_name("a"));
+        for (unsigned n = 0; n < 10; ++n) {
+            Id id = env.make_id(env.symbols().by_name("f2"));
+            id::nth_argument(nm, id, 0) = tree.root();
+            id::nth_argument(nm, id, 1) = id::copy_subtree(nm, tree.root());
+            tree.root() = id;
+        }
+        const Id& root = tree.root();
+        NodeNum num = 0;
+        bool same = true;
+        id::for_each_node(nm, root, [&](const Id& id, NodeNum n, NodeNum depth) {
+            NodeNum expected_depth;
+            same = same
+                && &id == &id::nth_node(nm, root, n, NodeFilter(), expected_depth)
+                && depth == expected_depth;
+            ++num;
+            return false;
+        });
+        CHECK(same);
+        CHECK(num == 2047);
+    }
+
+    // Deep tree, would overflow call stack with recursion
+    {
+        const NodeNum depth = 1000000;
+        Tree tree(&env, env.symbols().by_name("a"));
+        for (NodeNum n = 0; n < depth; ++n) {
+            Id id = env.make_id(env.symbols().by_name((n % 2) ? "f1" : "f2"));
+            id::nth_argument(nm, id, 0) = tree.root();
+            if (id.arity() == 2)
+                id::nth_argument(nm, id, 1) = env.make_id(env.symbols().by_name("b"));
+            tree.root() = id;
+        }
+        const NodeNum size = depth + depth / 2 + 1;
+        CHECK(id::subtree_size(nm, tree.root()) == size);
+        CHECK(id::is_valid_subtree(nm, tree.root()));
+        CHECK(tree.describe().depth == depth);
+        Tree copy(tree);
+        CHECK(id::subtree_size(nm, copy.root()) == size);
+        CHECK(!(tree.sub(size - 1).root() == copy.sub(size - 1).root()));
+        // Trees are destroyed without recursion
+    }
+    return 0;
+}
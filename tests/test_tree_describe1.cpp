@@ -0,0 +1,206 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+DEFUN_EMPTY(func);
+
+static unsigned cond(const stree::Arguments&, stree::DataPtr) {
+    return 0;
+}
+
+using namespace std;
+using namespace stree;
+
+using Random = std::mt19937;
+
+#define CHECK(_cond)                                            \
+    if (!(_cond)) {                                             \
+        cerr << "Check failed: " << #_cond << endl;             \
+        return -1;                                              \
+    }
+
+static Id grow(Environment& env, unsigned depth, Random& rd) {
+    const SymbolTable& symbols = env.symbols();
+    bool is_term = (depth == 0)
+        || std::uniform_int_distribution<unsigned>{0, 4}(rd) == 0;
+    const SymbolPtrList& list = is_term
+        ? symbols.terminals()
+        : symbols.nonterminals();
+    const SymbolPtr& symbol =
+        list[std::uniform_int_distribution<std::size_t>{0, list.size() - 1}(rd)];
+    Id id = env.make_id(symbol);
+    for (Arity n = 0; n < id.arity(); ++n) {
+        Id argument = grow(env, depth - 1, rd);
+        id::nth_argument(env.node_manager(), id, n) = argument;
+    }
+    return id;
+}
+
+static NodeNum random_num(NodeNum num, Random& rd) {
+    return std::uniform_int_distribution<NodeNum>{0, num - 1}(rd);
+}
+
+// Random subtree of tree
+static Subtree random_subtree(TreeBase& tree, Random& rd) {
+    const TreeDescription& description = tree.describe();
+    switch (std::uniform_int_distribution<unsigned>{0, 3}(rd)) {
+        case 0:
+            return tree.sub(random_num(description.size, rd));
+        case 1:
+            return tree.term(random_num(description.term_num, rd));
+        case 2:
+            if (description.nonterm_num > 0)
+                return tree.nonterm(random_num(description.nonterm_num, rd));
+            return tree.sub(0);
+        default:
+            if (tree.arity() > 0)
+                return tree.argument(random_num(tree.arity(), rd));
+            return tree.sub(0);
+    }
+}
+
+// Cached values are same as calculated for copy
+static bool check(const TreeBase& tree, const Tree& copy) {
+    const TreeDescription& d1 = tree.describe();
+    const TreeDescription& d2 = copy.describe();
+    if (d1.size != d2.size
+        || d1.depth != d2.depth
+        || d1.term_num != d2.term_num
+        || d1.nonterm_num != d2.nonterm_num
+        || d1.width != d2.width
+        || tree.width() != id::subtree_width(
+            copy.env()->node_manager(), copy.root()))
+    {
+        cerr << "Description mismatch for " << copy << endl
+             << "size " << d1.size << "/" << d2.size
+             << ", depth " << d1.depth << "/" << d2.depth
+             << ", term_num " << d1.term_num << "/" << d2.term_num
+             << ", nonterm_num " << d1.nonterm_num << "/" << d2.nonterm_num
+             << ", width " << d1.width << "/" << d2.width
+             << endl;
+        return false;
+    }
+    const TreeCostBound& b1 = tree.cost_bound();
+    const TreeCostBound& b2 = copy.cost_bound();
+    if (b1.min != b2.min || b1.max != b2.max || b1.select_num != b2.select_num) {
+        cerr << "Cost bound mismatch for " << copy << endl;
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("f1", 1, &func, 1);
+    env.add_function("f2", 2, &func, 2);
+    env.add_function("f3", 3, &func, 3);
+    env.add_select_function("if", 2, 1, &cond, 4);
+    env.add_positional("x", 0);
+    env.add_constant("one", 1);
+
+    // Deepest subtree replaced
+    {
+        Parser p(&env);
+        PARSE(p, "(f2 (f1 x) (f3 x (f1 (f1 x)) 1))");
+        Tree tree(&env, p.move_result());
+        CHECK(tree.describe().depth == 4);
+        CHECK(tree.describe().size == 9);
+        tree.sub(5).replace(Tree(&env, env.symbols().by_name("x")));
+        CHECK(to_string(tree) == "(f2 (f1 x) (f3 x x 1))");
+        CHECK(tree.describe().depth == 2);
+        CHECK(tree.describe().size == 7);
+        CHECK(tree.describe().term_num == 4);
+        CHECK(tree.describe().nonterm_num == 3);
+        CHECK(tree.width() == 4);
+        CHECK(tree.argument(1).width() == 3);
+        tree.sub(3).swap(tree.sub(5));
+        CHECK(to_string(tree) == "(f2 (f1 x) (f3 x x 1))");
+        CHECK(tree.describe().depth == 2);
+    }
+
+    // Empty argument replaced with described tree
+    {
+        Tree tree(&env, env.symbols().by_name("f2"));
+        Tree argument(&env, env.symbols().by_name("x"));
+        CHECK(argument.describe().size == 1);
+        tree.argument(0).replace(argument);
+        tree.argument(1).replace(Tree(&env, env.symbols().by_name("x")));
+        CHECK(to_string(tree) == "(f2 x x)");
+        CHECK(tree.describe().size == 3);
+    }
+
+    // Nodes modified directly, cache reset for subtree
+    {
+        Parser p(&env);
+        PARSE(p, "(f2 (f1 x) (f3 x (f1 (f1 x)) 1))");
+        Tree tree(&env, p.move_result());
+        tree.set_indexed(true);
+        CHECK(tree.describe().size == 9);
+        tree.cost_bound();
+        // Make nodes before taking subtree, allocation can move nodes
+        Id id = env.make_id(env.symbols().by_name("f3"));
+        for (Arity n = 0; n < id.arity(); ++n)
+            id::nth_argument(env.node_manager(), id, n) =
+                env.make_id(env.symbols().by_name("x"));
+        Subtree subtree = tree.argument(1);
+        CHECK(subtree.describe().size == 6);
+        Id& argument = id::nth_argument(env.node_manager(), subtree.root(), 1);
+        Tree old(&env, id::move(argument));
+        argument = id;
+        subtree.reset_cache();
+        CHECK(to_string(tree) == "(f2 (f1 x) (f3 x (f3 x x x) 1))");
+        CHECK(subtree.describe().size == 7);
+        CHECK(tree.describe().size == 10);
+        CHECK(tree.describe().depth == 3);
+        CHECK(to_string(tree.sub(5)) == "(f3 x x x)");
+        CHECK(check(tree, Tree(tree)));
+    }
+
+    Random rd(42);
+    for (unsigned iteration = 0; iteration < 200; ++iteration) {
+        Tree tree(&env, grow(env, 6, rd));
+        Tree other(&env, grow(env, 6, rd));
+        tree.describe();
+        tree.cost_bound();
+
+        for (unsigned n = 0; n < 20; ++n) {
+            unsigned op = std::uniform_int_distribution<unsigned>{0, 4}(rd);
+            if (op == 0) {
+                // Replace with new tree
+                Subtree subtree = random_subtree(tree, rd);
+                subtree.replace(Tree(&env, grow(env, 3, rd)));
+            } else if (op == 1) {
+                // Swap with other tree
+                Subtree subtree = random_subtree(tree, rd);
+                subtree.swap(random_subtree(other, rd));
+                if (!check(other, Tree(other)))
+                    return -1;
+            } else if (op == 2) {
+                // Swap within tree, subtrees should not overlap
+                if (tree.arity() < 2)
+                    continue;
+                Subtree subtree1 = tree.argument(0);
+                Subtree subtree2 = tree.argument(1);
+                random_subtree(subtree1, rd).swap(random_subtree(subtree2, rd));
+            } else if (op == 3) {
+                // Replace in subtree of subtree
+                Subtree subtree = random_subtree(tree, rd);
+                subtree.describe();
+                Subtree subsubtree = random_subtree(subtree, rd);
+                subsubtree.replace(Tree(&env, grow(env, 2, rd)));
+                if (!check(subtree, subtree.copy()))
+                    return -1;
+            } else {
+                // Replace root symbol
+                if (tree.arity() == 2)
+                    tree.set(std::uniform_int_distribution<unsigned>{0, 1}(rd) ? "if" : "f2");
+            }
+            if (!check(tree, Tree(tree)))
+                return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <stree/stree.hpp>
+#include "macros.hpp"
+
+DEFUN_EMPTY(func);
+
+static unsigned cond(const stree::Arguments&, stree::DataPtr) {
+    return 0;
+}
+
+using namespace std;
+using namespace stree;
+
+using Random = std::mt19937;
+
+static Id grow(Environment& env, unsigned depth, Random& rd) {
+    const SymbolTable& symbols = env.symbols();
+    bool is_term = (depth == 0)
+        || std::uniform_int_distribution<unsigned>{0, 4}(rd) == 0;
+    const SymbolPtrList& list = is_term
+        ? symbols.terminals()
+        : symbols.nonterminals();
+    const SymbolPtr& symbol =
+        list[std::uniform_int_distribution<std::size_t>{0, list.size() - 1}(rd)];
+    Id id = env.make_id(symbol);
+    for (Arity n = 0; n < id.arity(); ++n) {
+        Id argument = grow(env, depth - 1, rd);
+        id::nth_argument(env.node_manager(), id, n) = argument;
+    }
+    return id;
+}
+
+static NodeNum random_num(NodeNum num, Random& rd) {
+    return std::uniform_int_distribution<NodeNum>{0, num - 1}(rd);
+}
+
+// Indexed lookup finds same nodes as BFS
+static bool check(Tree& tree) {
+    NodeManager& nm = tree.env()->node_manager();
+    const TreeDescription& description = tree.describe();
+    for (IsTerminal is_terminal : {IsTerminalAny, IsTerminalYes, IsTerminalNo}) {
+        NodeFilter filter;
+        filter.is_terminal = is_terminal;
+        NodeNum num = description.size;
+        if (is_terminal == IsTerminalYes)
+            num = description.term_num;
+        if (is_terminal == IsTerminalNo)
+            num = description.nonterm_num;
+        for (NodeNum n = 0; n < num; ++n) {
+            Id& expected = id::nth_node(nm, tree.root(), n, filter);
+            if (&tree.sub(n, filter).root() != &expected) {
+                cerr << "Wrong node " << n << " (filter "
+                     << is_terminal << ") in " << tree << endl;
+                return false;
+            }
+        }
+        try {
+            tree.sub(num, filter);
+            cerr << "No error for node " << num << endl;
+            return false;
+        } catch (const std::range_error&) {}
+    }
+    return true;
+}
+
+#define CHECK(_cond)                                            \
+    if (!(_cond)) {                                             \
+        cerr << "Check failed: " << #_cond << endl;             \
+        return -1;                                              \
+    }
+
+int main() {
+    // Init environment
+    Environment env;
+    env.add_function("f1", 1, &func);
+    env.add_function("f2", 2, &func);
+    env.add_function("f3", 3, &func);
+    env.add_select_function("if", 2, 1, &cond);
+    env.add_positional("x", 0);
+    env.add_constant("one", 1);
+
+    // Same numbering as nth_node
+    {
+        Parser p(&env);
+        PARSE(p, "(f2 x (f2 (f2 x x) one))");
+        Tree tree(&env, p.move_result());
+        tree.set_indexed(true);
+        CHECK(tree.is_indexed());
+        CHECK(to_string(tree.sub(3)) == "(f2 x x)");
+        CHECK(to_string(tree.term(1)) == "1");
+        CHECK(to_string(tree.nonterm(2)) == "(f2 x x)");
+        CHECK(check(tree));
+        // Copy is indexed
+        Tree copy(tree);
+        CHECK(copy.is_indexed());
+        CHECK(check(copy));
+    }
+
+    Random rd(7);
+
+    // Large subtree swapped with small one in same tree,
+    // removed entries are dropped after swap
+    for (unsigned iteration = 0; iteration < 10; ++iteration) {
+        Tree large(&env, grow(env, 8, rd));
+        while (large.describe().size < 200)
+            large = Tree(&env, grow(env, 8, rd));
+        Tree tree(&env, env.symbols().by_name("f2"));
+        tree.argument(0).replace(large);
+        tree.argument(1).replace(Tree(&env, grow(env, 2, rd)));
+        tree.set_indexed(true);
+        CHECK(check(tree));
+        Subtree small = tree.argument(1);
+        tree.argument(0).swap(
+            small.sub(random_num(small.describe().size, rd)));
+        CHECK(check(tree));
+        tree.argument(1).swap(tree.argument(0));
+        CHECK(check(tree));
+    }
+    for (unsigned iteration = 0; iteration < 100; ++iteration) {
+        Tree tree(&env, grow(env, 6, rd));
+        Tree other(&env, grow(env, 6, rd));
+        tree.set_indexed(true);
+        other.set_indexed(iteration % 2 == 0);
+        if (!check(tree))
+            return -1;
+
+        for (unsigned n = 0; n < 20; ++n) {
+            const TreeDescription& description = tree.describe();
+            unsigned op = std::uniform_int_distribution<unsigned>{0, 6}(rd);
+            if (op == 0) {
+                // Replace with new tree
+                tree.sub(random_num(description.size, rd))
+                    .replace(Tree(&env, grow(env, 3, rd)));
+            } else if (op == 1) {
+                // Swap with other tree
+                tree.term(random_num(description.term_num, rd))
+                    .swap(other.sub(random_num(other.describe().size, rd)));
+                if (!check(other))
+                    return -1;
+            } else if (op == 2) {
+                // Swap within tree
+                if (tree.arity() < 2)
+                    continue;
+                Subtree subtree1 = tree.argument(0);
+                Subtree subtree2 = tree.argument(1);
+                subtree1.sub(random_num(subtree1.describe().size, rd))
+                    .swap(subtree2.sub(random_num(subtree2.describe().size, rd)));
+            } else if (op == 3) {
+                // Replace symbol
+                Subtree subtree = tree.sub(random_num(description.size, rd));
+                if (subtree.arity() == 2)
+                    subtree.set((n % 2 == 0) ? "if" : "f2");
+                if (subtree.arity() == 0)
+                    subtree.set("one");
+            } else if (op == 4) {
+                // Replace in subtree of subtree
+                Subtree subtree = tree.sub(random_num(description.size, rd));
+                subtree.sub(random_num(subtree.describe().size, rd))
+                    .replace(Tree(&env, grow(env, 2, rd)));
+            } else if (op == 5) {
+                // Swap argument with subtree of other argument
+                if (tree.arity() < 2)
+                    continue;
+                Subtree subtree = tree.argument(1);
+                tree.argument(0).swap(
+                    subtree.sub(random_num(subtree.describe().size, rd)));
+            } else {
+                // Replace root
+                tree.sub(0).replace(Tree(&env, grow(env, 4, rd)));
+            }
+            if (!check(tree))
+                return -1;
+        }
+    }
+    return 0;
+}